@@ -9,7 +9,9 @@ bencode_reinit(struct bencode *ctx, const void *buf, size_t len)
     ctx->toklen = 0;
     ctx->buf = buf;
     ctx->buflen = len;
+    ctx->base = buf;
     ctx->size = 0;
+    ctx->keyid = -1;
 }
 
 void
@@ -19,9 +21,51 @@ bencode_init(struct bencode *ctx, const void *buf, size_t len)
     ctx->toklen = 0;
     ctx->buf = buf;
     ctx->buflen = len;
+    ctx->base = buf;
     ctx->stack = 0;
     ctx->cap = 0;
     ctx->size = 0;
+    ctx->options = 0;
+    ctx->keyid = -1;
+    ctx->keys = 0;
+    ctx->keylens = 0;
+    ctx->keyfirst = 0;
+    ctx->nkeys = 0;
+    ctx->keycap = 0;
+}
+
+int
+bencode_keys(struct bencode *ctx, const char *const *keys, size_t n)
+{
+    size_t i, c;
+    ctx->keys = 0;
+    ctx->nkeys = 0;
+    if (!keys)
+        return 0;
+    if (n > ctx->keycap) {
+        /* Lengths, then the index of each first byte */
+        size_t *keylens;
+        size_t bytes = (n + 257) * sizeof(*keylens);
+        if (n > (size_t)-1 - 257 || bytes / sizeof(*keylens) != n + 257)
+            return BENCODE_ERROR_OOM;
+        keylens = realloc(ctx->keylens, bytes);
+        if (!keylens)
+            return BENCODE_ERROR_OOM;
+        ctx->keylens = keylens;
+        ctx->keycap = n;
+    }
+    ctx->keyfirst = ctx->keylens + n;
+    for (i = c = 0; i < n; i++) {
+        size_t first = *(const unsigned char *)keys[i];
+        ctx->keylens[i] = strlen(keys[i]);
+        while (c <= first)
+            ctx->keyfirst[c++] = i;
+    }
+    while (c <= 256)
+        ctx->keyfirst[c++] = n;
+    ctx->keys = keys;
+    ctx->nkeys = n;
+    return 0;
 }
 
 void
@@ -29,6 +73,12 @@ bencode_free(struct bencode *ctx)
 {
     free(ctx->stack);
     ctx->stack = 0;
+    free(ctx->keylens);
+    ctx->keys = 0;
+    ctx->keylens = 0;
+    ctx->keyfirst = 0;
+    ctx->nkeys = 0;
+    ctx->keycap = 0;
 }
 
 static int
@@ -50,6 +100,15 @@ bencode_peek(struct bencode *ctx)
     return *(unsigned char *)ctx->buf;;
 }
 
+/* Back up over the byte just read and report it as invalid. */
+static int
+bencode_invalid(struct bencode *ctx)
+{
+    ctx->buf = (char *)ctx->buf - 1;
+    ctx->buflen++;
+    return BENCODE_ERROR_INVALID;
+}
+
 static size_t
 bencode_push(struct bencode *ctx)
 {
@@ -63,14 +122,25 @@ bencode_push(struct bencode *ctx)
             if (!newcap) return -1;
         }
         bytes = newcap * sizeof(ctx->stack[0]);
-        if (!bytes) return -1;
+        if (bytes / sizeof(ctx->stack[0]) != newcap) return -1;
         newstack = realloc(ctx->stack, bytes);
         if (!newstack) return -1;
         ctx->stack = newstack;
+        ctx->cap = newcap;
     }
     return ctx->size++;
 }
 
+/* Compare two keys in bencode dictionary order. */
+static int
+bencode_keycmp(const void *a, size_t alen, const void *b, size_t blen)
+{
+    int r = memcmp(a, b, alen < blen ? alen : blen);
+    if (r)
+        return r;
+    return alen < blen ? -1 : alen > blen;
+}
+
 static int
 bencode_integer(struct bencode *ctx)
 {
@@ -87,19 +157,19 @@ bencode_integer(struct bencode *ctx)
             if (c == -1)
                 return BENCODE_ERROR_EOF;
             if (c < 0x31 || c > 0x39) /* 1-9 */
-                return BENCODE_ERROR_INVALID;
+                return bencode_invalid(ctx);
             break;
         case 0x30: /* 0 */
             c = bencode_get(ctx);
             if (c == -1)
                 return BENCODE_ERROR_EOF;
             if (c != 0x65) /* e */
-                return BENCODE_ERROR_INVALID;
+                return bencode_invalid(ctx);
             ctx->toklen = 1;
             return BENCODE_INTEGER;
     }
     if (c < 0x30 || c > 0x39)
-        return BENCODE_ERROR_INVALID;
+        return bencode_invalid(ctx);
 
     /* Read until 'e' */
     do
@@ -108,7 +178,7 @@ bencode_integer(struct bencode *ctx)
     if (c == -1)
         return BENCODE_ERROR_EOF;
     if (c != 0x65) /* e */
-        return BENCODE_ERROR_INVALID;
+        return bencode_invalid(ctx);
     ctx->toklen = (char *)ctx->buf - (char *)ctx->tok - 1;
     return BENCODE_INTEGER;
 }
@@ -118,29 +188,29 @@ bencode_string(struct bencode *ctx)
 {
     int c;
     const unsigned char *tok = (unsigned char *)ctx->buf - 1;
+    size_t len = *tok - 0x30;
 
-    /* Consume the remaining digits */
-    do
+    /* Decode the remaining digits */
+    for (;;) {
         c = bencode_get(ctx);
-    while (c >= 0x30 && c <= 0x39);
+        if (c < 0x30 || c > 0x39) /* 0-9 */
+            break;
+        if (len > ((size_t)-1 - (c - 0x30)) / 10) {
+            /* No buffer can hold the string, so more input cannot help */
+            ctx->buflen += (unsigned char *)ctx->buf - tok;
+            ctx->buf = tok;
+            return BENCODE_ERROR_INVALID;
+        }
+        len = len * 10 + (c - 0x30);
+    }
     if (c == -1)
         return BENCODE_ERROR_EOF;
     if (c != 0x3a) /* : */
-        return BENCODE_ERROR_INVALID;
-
-    /* Decode the length */
-    ctx->tok = ctx->buf;
-    ctx->toklen = 0;
-    for (; tok < (unsigned char *)ctx->buf - 1; tok++) {
-        size_t n = ctx->toklen * 10 + (*tok - 0x30);
-        if (n < ctx->toklen) {
-            /* Overflow: length definitely extends beyond the buffer size */
-            return BENCODE_ERROR_EOF;
-        }
-        ctx->toklen = n;
-    }
+        return bencode_invalid(ctx);
 
     /* Advance input to end of string */
+    ctx->tok = ctx->buf;
+    ctx->toklen = len;
     if (ctx->buflen < ctx->toklen)
         return BENCODE_ERROR_EOF;
     ctx->buf = (char *)ctx->buf + ctx->toklen;
@@ -148,14 +218,15 @@ bencode_string(struct bencode *ctx)
     return BENCODE_STRING;
 }
 
-int
-bencode_next(struct bencode *ctx)
+static int
+bencode_step(struct bencode *ctx)
 {
     int c, r;
     size_t i;
     void **keyptr = 0;
     size_t *keylenptr = 0;
 
+    ctx->keyid = -1;
     if (ctx->size) {
         int *flags = &ctx->stack[ctx->size - 1].flags;
         *flags &= ~BENCODE_FLAG_FIRST;
@@ -169,6 +240,8 @@ bencode_next(struct bencode *ctx)
                 *flags &= ~BENCODE_FLAG_EXPECT_VALUE;
             } else {
                 /* Next value must look like a string or 'e' */
+                if (c == -1)
+                    return BENCODE_ERROR_EOF;
                 if (c != 0x65 && (c < 0x30 || c > 0x39)) /* e, 0-9 */
                     return BENCODE_ERROR_INVALID;
                 *flags |= BENCODE_FLAG_EXPECT_VALUE;
@@ -176,11 +249,13 @@ bencode_next(struct bencode *ctx)
                 keylenptr = &ctx->stack[ctx->size - 1].keylen;
             }
         }
+    } else if (ctx->tok) {
+        /* Top-level value is complete */
+        return ctx->buflen ? BENCODE_ERROR_INVALID : BENCODE_DONE;
     } else if (ctx->buflen == 0) {
-        return ctx->tok ? BENCODE_DONE : BENCODE_ERROR_EOF;
+        return BENCODE_ERROR_EOF;
     }
 
-    r = BENCODE_ERROR_INVALID;
     c = bencode_get(ctx);
     switch (c) {
         case -1:
@@ -191,12 +266,16 @@ bencode_next(struct bencode *ctx)
                 return BENCODE_ERROR_OOM;
             ctx->stack[i].key = 0;
             ctx->stack[i].keylen = 0;
+            ctx->stack[i].start = (char *)ctx->buf - 1;
+            ctx->stack[i].keypos = 0;
             ctx->stack[i].flags = BENCODE_FLAG_DICT | BENCODE_FLAG_FIRST;
             return BENCODE_DICT_BEGIN;
         case 0x65: /* e */
             if (!ctx->size)
-                return BENCODE_ERROR_INVALID;
+                return bencode_invalid(ctx);
             i = --ctx->size;
+            ctx->tok = ctx->stack[i].start;
+            ctx->toklen = (char *)ctx->buf - (char *)ctx->tok;
             if (ctx->stack[i].flags & BENCODE_FLAG_DICT)
                 return BENCODE_DICT_END;
             return BENCODE_LIST_END;
@@ -206,6 +285,7 @@ bencode_next(struct bencode *ctx)
             i = bencode_push(ctx);
             if (i == (size_t)-1)
                 return BENCODE_ERROR_OOM;
+            ctx->stack[i].start = (char *)ctx->buf - 1;
             ctx->stack[i].flags = BENCODE_FLAG_FIRST;
             return BENCODE_LIST_BEGIN;
         case 0x30: /* 0 */
@@ -213,7 +293,7 @@ bencode_next(struct bencode *ctx)
             if (c == -1)
                 return BENCODE_ERROR_EOF;
             if (c != 0x3a) /* : */
-                return BENCODE_ERROR_INVALID;
+                return bencode_invalid(ctx);
             ctx->tok = ctx->buf;
             ctx->toklen = 0;
             r = BENCODE_STRING;
@@ -229,25 +309,434 @@ bencode_next(struct bencode *ctx)
         case 0x39: /* 9 */
             r = bencode_string(ctx);
             break;
+        default:
+            return bencode_invalid(ctx);
     }
 
     if (r == BENCODE_STRING && keyptr) {
         /* Enforce key ordering */
-        if (*keyptr) {
-            if (ctx->toklen < *keylenptr) {
-                if (memcmp(ctx->tok, *keyptr, ctx->toklen) <= 0)
-                    return BENCODE_ERROR_BAD_KEY;
-            } else if (*keylenptr < ctx->toklen ) {
-                if (memcmp(ctx->tok, *keyptr, *keylenptr) < 0)
-                    return BENCODE_ERROR_BAD_KEY;
-            } else {
-                if (memcmp(ctx->tok, *keyptr, ctx->toklen) <= 0)
-                    return BENCODE_ERROR_BAD_KEY;
-            }
+        if (*keyptr && !(ctx->options & BENCODE_OPTION_UNSORTED)) {
+            if (bencode_keycmp(ctx->tok, ctx->toklen,
+                               *keyptr, *keylenptr) <= 0)
+                return BENCODE_ERROR_BAD_KEY;
         }
         *keyptr = (void *)ctx->tok;
         *keylenptr = ctx->toklen;
+
+        if (ctx->nkeys) {
+            /* Advance through the registered keys in step, comparing
+             * only those with the same first byte. The key at the
+             * position was passed when it matched, since the order
+             * check has shown this key to be greater. */
+            const unsigned char *tok = ctx->tok;
+            size_t len = ctx->toklen;
+            size_t first = len ? tok[0] : 0;
+            size_t *pos = &ctx->stack[ctx->size - 1].keypos;
+            size_t i = ctx->options & BENCODE_OPTION_UNSORTED ? 0 : *pos;
+            size_t end = ctx->keyfirst[first + 1];
+            int cmp = 1;
+            if (i < ctx->keyfirst[first])
+                i = ctx->keyfirst[first];
+            for (; i < end; i++) {
+                cmp = bencode_keycmp(tok, len, ctx->keys[i],
+                                     ctx->keylens[i]);
+                if (cmp <= 0)
+                    break;
+            }
+            if (!cmp)
+                ctx->keyid = i++;
+            *pos = i;
+        }
     }
 
     return r;
 }
+
+int
+bencode_next(struct bencode *ctx)
+{
+    /* Save state so that truncated input can be resumed */
+    const void *tok = ctx->tok;
+    size_t toklen = ctx->toklen;
+    const void *buf = ctx->buf;
+    size_t buflen = ctx->buflen;
+    int flags = ctx->size ? ctx->stack[ctx->size - 1].flags : 0;
+
+    int r = bencode_step(ctx);
+    if (r == BENCODE_ERROR_INVALID) {
+        /* Don't leave a partial token behind */
+        ctx->tok = tok;
+        ctx->toklen = toklen;
+    } else if (r == BENCODE_ERROR_EOF) {
+        ctx->tok = tok;
+        ctx->toklen = toklen;
+        ctx->buf = buf;
+        ctx->buflen = buflen;
+        if (ctx->size)
+            ctx->stack[ctx->size - 1].flags = flags;
+    }
+    return r;
+}
+
+void
+bencode_extend(struct bencode *ctx, size_t len)
+{
+    ctx->buflen += len;
+}
+
+/* Return the address at p's offset from "from" relative to "to". */
+static void *
+bencode_move(const void *p, const void *from, const void *to)
+{
+    if (!p)
+        return 0;
+    return (char *)to + ((const char *)p - (const char *)from);
+}
+
+void
+bencode_rebase(struct bencode *ctx, const void *buf)
+{
+    size_t i;
+    const void *old = ctx->base;
+    ctx->tok = bencode_move(ctx->tok, old, buf);
+    ctx->buf = bencode_move(ctx->buf, old, buf);
+    for (i = 0; i < ctx->size; i++) {
+        /* Only dictionary frames record a key */
+        if (ctx->stack[i].flags & BENCODE_FLAG_DICT)
+            ctx->stack[i].key = bencode_move(ctx->stack[i].key, old, buf);
+        ctx->stack[i].start = bencode_move(ctx->stack[i].start, old, buf);
+    }
+    ctx->base = buf;
+}
+
+/* Return 1 if c may begin a value. */
+static int
+bencode_isvalue(int c)
+{
+    return c == 0x64 || c == 0x69 || c == 0x6c || /* d, i, l */
+           (c >= 0x30 && c <= 0x39);               /* 0-9 */
+}
+
+/* Return 1 if input may follow the close of the current container. */
+static int
+bencode_closes(struct bencode *ctx, const unsigned char *p, size_t n)
+{
+    int flags;
+    if (ctx->size < 2)
+        return !n;
+    if (!n)
+        return 1;
+    flags = ctx->stack[ctx->size - 2].flags;
+    if (flags & BENCODE_FLAG_DICT)
+        return *p == 0x65 || (*p >= 0x30 && *p <= 0x39); /* e, 0-9 */
+    return *p == 0x65 || bencode_isvalue(*p);
+}
+
+/* Return 1 if a well-formed element starts at p in the current context. */
+static int
+bencode_plausible(struct bencode *ctx, const unsigned char *p, size_t n)
+{
+    struct bencode tmp = *ctx;
+    int dict = ctx->size &&
+               ctx->stack[ctx->size - 1].flags & BENCODE_FLAG_DICT;
+
+    tmp.buf = p + 1;
+    tmp.buflen = n - 1;
+    switch (*p) {
+        case 0x65: /* e */
+            return ctx->size && bencode_closes(ctx, p + 1, n - 1);
+        case 0x64: /* d */
+        case 0x6c: /* l */
+            return !dict;
+        case 0x69: /* i */
+            return !dict && bencode_integer(&tmp) == BENCODE_INTEGER;
+        case 0x30: /* 0 */
+            if (n < 2 || p[1] != 0x3a) /* : */
+                return 0;
+            tmp.buf = p + 2;
+            tmp.buflen = n - 2;
+            break;
+        default:
+            if (*p < 0x31 || *p > 0x39) /* 1-9 */
+                return 0;
+            if (bencode_string(&tmp) != BENCODE_STRING)
+                return 0;
+    }
+
+    /* A key must be followed by a value */
+    if (dict && tmp.buflen)
+        return bencode_isvalue(*(unsigned char *)tmp.buf);
+    return 1;
+}
+
+int
+bencode_recover(struct bencode *ctx, int error)
+{
+    const unsigned char *p;
+    size_t n;
+
+    if (!ctx->size && ctx->tok) {
+        /* The top-level value is complete, drop trailing garbage */
+        ctx->buf = (char *)ctx->buf + ctx->buflen;
+        ctx->buflen = 0;
+        return BENCODE_DONE;
+    }
+
+    if (error == BENCODE_ERROR_BAD_KEY) {
+        /* Try to skip the value belonging to the rejected key */
+        size_t size = ctx->size;
+        int r;
+        do
+            r = bencode_next(ctx);
+        while (r > 0 && ctx->size > size);
+        if (r > 0)
+            return BENCODE_DONE;
+        if (r == BENCODE_ERROR_OOM)
+            return r;
+        ctx->size = size;
+    }
+
+    /* Scan forward for the next plausible element in this container */
+    p = ctx->buf;
+    n = ctx->buflen;
+    while (n && !bencode_plausible(ctx, p, n)) {
+        size_t run = 0;
+        while (run < n && p[run] >= 0x30 && p[run] <= 0x39) /* 0-9 */
+            run++;
+        if (run > 1 && run < n && p[run] != 0x3a) {
+            /* No suffix of this digit run is a length prefix either */
+            p += run;
+            n -= run;
+        } else if (run > 20) {
+            /* Longer suffixes exceed any size_t, skip to the last few */
+            p += run - 20;
+            n -= run - 20;
+        } else {
+            p++;
+            n--;
+        }
+    }
+    ctx->buf = p;
+    ctx->buflen = n;
+    if (ctx->size)
+        ctx->stack[ctx->size - 1].flags &= ~BENCODE_FLAG_EXPECT_VALUE;
+    return n ? BENCODE_DONE : BENCODE_ERROR_EOF;
+}
+
+struct bencode_entry {
+    const void *key;  /* null marks the start of a dictionary */
+    size_t keylen;
+    size_t off;
+    size_t len;
+};
+
+static int
+bencode_entrycmp(const void *pa, const void *pb)
+{
+    const struct bencode_entry *a = pa;
+    const struct bencode_entry *b = pb;
+    return bencode_keycmp(a->key, a->keylen, b->key, b->keylen);
+}
+
+int
+bencode_canonicalize(struct bencode *ctx, void *out)
+{
+    int r;
+    const char *src = ctx->buf;
+    int options = ctx->options;
+    struct bencode_entry *entries = 0;
+    size_t nentries = 0;
+    size_t capentries = 0;
+    char *tmp = 0;
+    size_t captmp = 0;
+
+    /* The output differs from the input only where entries move */
+    if (ctx->buflen)
+        memcpy(out, src, ctx->buflen);
+
+    ctx->options |= BENCODE_OPTION_UNSORTED;
+    for (;;) {
+        size_t i, base, end, len, pos;
+        int sorted;
+
+        r = bencode_next(ctx);
+        if (r <= 0)
+            break;
+
+        if (r == BENCODE_DICT_BEGIN ||
+            (r == BENCODE_STRING && BENCODE_IS_VALUE(ctx))) {
+            /* Record a dictionary marker or a key */
+            if (nentries == capentries) {
+                void *newentries;
+                size_t bytes, newcap;
+                newcap = capentries ? capentries * 2 : 64;
+                bytes = newcap * sizeof(entries[0]);
+                if (bytes / sizeof(entries[0]) != newcap)
+                    goto oom;
+                newentries = realloc(entries, bytes);
+                if (!newentries)
+                    goto oom;
+                entries = newentries;
+                capentries = newcap;
+            }
+            entries[nentries].key = 0;
+            entries[nentries].keylen = 0;
+            if (r == BENCODE_STRING) {
+                /* Back up over the length prefix and its colon */
+                size_t n = ctx->toklen;
+                size_t prefix = 1;
+                do {
+                    prefix++;
+                    n /= 10;
+                } while (n);
+                entries[nentries].key = ctx->tok;
+                entries[nentries].keylen = ctx->toklen;
+                entries[nentries].off = (char *)ctx->tok - src - prefix;
+            }
+            nentries++;
+            continue;
+        }
+
+        if (r != BENCODE_DICT_END)
+            continue;
+
+        /* Find this dictionary's entries and check their order */
+        for (base = nentries; entries[base - 1].key; base--);
+        sorted = 1;
+        for (i = base + 1; i < nentries; i++) {
+            if (bencode_entrycmp(entries + i - 1, entries + i) >= 0) {
+                sorted = 0;
+                break;
+            }
+        }
+
+        if (!sorted) {
+            /* Entries are contiguous, each running to the next */
+            end = (char *)ctx->tok + ctx->toklen - 1 - src;
+            for (i = base; i < nentries; i++) {
+                size_t next = i + 1 < nentries ? entries[i + 1].off : end;
+                entries[i].len = next - entries[i].off;
+            }
+            qsort(entries + base, nentries - base, sizeof(entries[0]),
+                  bencode_entrycmp);
+            for (i = base + 1; i < nentries; i++) {
+                if (!bencode_entrycmp(entries + i - 1, entries + i)) {
+                    ctx->tok = entries[i].key;
+                    ctx->toklen = entries[i].keylen;
+                    r = BENCODE_ERROR_BAD_KEY;
+                    goto done;
+                }
+            }
+
+            /* Permute the entries via a scratch buffer */
+            pos = (char *)ctx->tok - src + 1;
+            len = end - pos;
+            if (captmp < len) {
+                free(tmp);
+                tmp = malloc(len);
+                if (!tmp)
+                    goto oom;
+                captmp = len;
+            }
+            len = 0;
+            for (i = base; i < nentries; i++) {
+                memcpy(tmp + len, (char *)out + entries[i].off,
+                       entries[i].len);
+                len += entries[i].len;
+            }
+            memcpy((char *)out + pos, tmp, len);
+        }
+        nentries = base - 1;
+    }
+    goto done;
+
+oom:
+    r = BENCODE_ERROR_OOM;
+done:
+    ctx->options = options;
+    free(entries);
+    free(tmp);
+    return r;
+}
+
+int
+bencode_locate(struct bencode *ctx,
+               const char *const *path,
+               size_t *off,
+               size_t *len)
+{
+    int r;
+    const char *src = ctx->buf;
+    int result = BENCODE_ERROR_NOT_FOUND;
+    int searching = 1;
+    int pending = 1;      /* next value is the current path target */
+    size_t level = 0;     /* number of keys matched */
+    size_t dictsize = 0;  /* stack size inside the dictionary searched */
+    size_t closing = -1;  /* stack size when target container closes */
+
+    for (;;) {
+        const char *start = ctx->buf;
+        r = bencode_next(ctx);
+        if (r < 0)
+            return r;
+        if (r == BENCODE_DONE)
+            break;
+        if (!searching)
+            continue;
+
+        if (closing != (size_t)-1) {
+            /* Waiting for the target container to end */
+            if (ctx->size == closing) {
+                *len = ctx->toklen;
+                searching = 0;
+            }
+
+        } else if (pending) {
+            pending = 0;
+            if (!path[level]) {
+                result = r;
+                *off = start - src;
+                if (r == BENCODE_LIST_BEGIN || r == BENCODE_DICT_BEGIN) {
+                    closing = ctx->size - 1;
+                } else {
+                    *len = (char *)ctx->buf - start;
+                    searching = 0;
+                }
+            } else if (r == BENCODE_DICT_BEGIN) {
+                dictsize = ctx->size;
+            } else {
+                searching = 0;
+            }
+
+        } else if (ctx->size == dictsize && r == BENCODE_STRING &&
+                   BENCODE_IS_VALUE(ctx)) {
+            /* A key in the dictionary being searched */
+            const char *key = path[level];
+            int cmp = bencode_keycmp(ctx->tok, ctx->toklen,
+                                     key, strlen(key));
+            if (!cmp) {
+                level++;
+                pending = 1;
+            } else if (cmp > 0 &&
+                       !(ctx->options & BENCODE_OPTION_UNSORTED)) {
+                /* Passed the place where the key would be */
+                if (!path[level + 1]) {
+                    result = BENCODE_DONE;
+                    *off = start - src;
+                    *len = 0;
+                }
+                searching = 0;
+            }
+
+        } else if (ctx->size == dictsize - 1 && r == BENCODE_DICT_END) {
+            /* Key not present, belongs before the terminator */
+            if (!path[level + 1]) {
+                result = BENCODE_DONE;
+                *off = (char *)ctx->buf - src - 1;
+                *len = 0;
+            }
+            searching = 0;
+        }
+    }
+    return result;
+}
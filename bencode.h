@@ -1,8 +1,9 @@
 /* Bencode decoder in ANSI C
  *
- * This library only allocates a small stack, though it expects the
- * entire input at once up front. All returned pointers point into this
- * user-supplied buffer.
+ * This library only allocates a small stack and a table of registered
+ * keys, and expects the input in a single buffer, though that buffer
+ * may be filled incrementally (see bencode_extend()). All returned
+ * pointers point into this user-supplied buffer.
  *
  * This is free and unencumbered software released into the public domain.
  */
@@ -11,6 +12,7 @@
 
 #include <stddef.h>
 
+#define BENCODE_ERROR_NOT_FOUND  -5
 #define BENCODE_ERROR_OOM        -4
 #define BENCODE_ERROR_BAD_KEY    -3
 #define BENCODE_ERROR_EOF        -2
@@ -23,6 +25,8 @@
 #define BENCODE_DICT_BEGIN        5
 #define BENCODE_DICT_END          6
 
+#define BENCODE_OPTION_UNSORTED    (1 << 0)
+
 #define BENCODE_FLAG_FIRST         (1 << 0)
 #define BENCODE_FLAG_DICT          (1 << 1)
 #define BENCODE_FLAG_EXPECT_VALUE  (1 << 2)
@@ -48,18 +52,35 @@ struct bencode {
     size_t toklen;
     const void *buf;
     size_t buflen;
+    const void *base;
     struct {
         void *key;
         size_t keylen;
+        const void *start;
+        size_t keypos;
         int flags;
     } *stack;
     size_t cap;
     size_t size;
+    int options;
+    int keyid;
+    const char *const *keys;
+    size_t *keylens;
+    size_t *keyfirst;
+    size_t nkeys;
+    size_t keycap;
 };
 
 /**
  * Initialize a new decoder on the given buffer.
  *
+ * All options are initially off. Options are enabled by setting bits in
+ * the "options" member:
+ *
+ * BENCODE_OPTION_UNSORTED: Accept dictionary keys in any order. Keys
+ * are not checked for ordering nor for duplicates, and
+ * BENCODE_ERROR_BAD_KEY is never returned.
+ *
  * This function cannot fail.
  */
 void bencode_init(struct bencode *, const void *, size_t);
@@ -69,10 +90,30 @@ void bencode_init(struct bencode *, const void *, size_t);
  *
  * Use this on an encoder previously initalized with bencode_init(), but
  * never freed with bencode_free(). This will reuse memory allocated for
- * the previous parsing tasks.
+ * the previous parsing tasks. Options are retained.
  */
 void bencode_reinit(struct bencode *, const void *, size_t);
 
+/**
+ * Register a set of known dictionary keys.
+ *
+ * The keys are null-terminated and must be sorted in dictionary key
+ * order, i.e. by strcmp() on unsigned bytes, without duplicates. The
+ * array is not copied and must outlive the parser. After bencode_next()
+ * returns a dictionary key, the "keyid" member holds its index in this
+ * array, or -1 for an unknown key. It is -1 after any other token.
+ *
+ * Since keys arrive sorted, matching is a single merge over the key set
+ * per dictionary, and only keys sharing a first byte are compared. The
+ * key lengths and a first byte index are computed once here, into a
+ * table kept for reuse until bencode_free(). Registered keys are
+ * retained by bencode_reinit(). Pass a null array to unregister.
+ *
+ * Returns 0, or BENCODE_ERROR_OOM if the table cannot be allocated, in
+ * which case no keys are registered.
+ */
+int bencode_keys(struct bencode *, const char *const *, size_t);
+
 /**
  * Destroy the given encoder by freeing any resources.
  */
@@ -82,7 +123,10 @@ void bencode_free(struct bencode *);
  * Return the next token in the input stream.
  *
  * Non-negative return values indicate success, negative return values
- * indicate errors. Errors are not recoverable, including OOM, though
+ * indicate errors. After BENCODE_ERROR_EOF, parsing can resume once more
+ * input arrives (see bencode_extend()). After BENCODE_ERROR_INVALID or
+ * BENCODE_ERROR_BAD_KEY, bencode_recover() can skip the damage and
+ * parsing continues. BENCODE_ERROR_OOM is not recoverable, though
  * bencode_free() and bencode_reset() will still work correctly.
  *
  * Returns one of the following values:
@@ -101,28 +145,132 @@ void bencode_free(struct bencode *);
  * BENCODE_LIST_BEGIN: Found the beginning of a list.
  *
  * BENCODE_LIST_END: Found the end of the current list. This will always
- * be correctly paired with a BENCODE_LIST_BEGIN.
+ * be correctly paired with a BENCODE_LIST_BEGIN. The "tok" and "toklen"
+ * members span the raw encoding of the entire list, including its
+ * delimiters.
  *
  * BENCODE_DICT_BEGIN: Found the beginning of a dictionary. While inside
  * the dictionary, the parser will alternate between a string (key) and
  * another object (value).
  *
  * BENCODE_DICT_END: Found the end of the current dictionary. This will
- * always be correctly paired with a BENCODE_DICT_BEGIN.
+ * always be correctly paired with a BENCODE_DICT_BEGIN. The "tok" and
+ * "toklen" members span the raw encoding of the entire dictionary,
+ * including its delimiters. For example, this is exactly the input to
+ * a BitTorrent info hash.
  *
  * BENCODE_ERROR_INVALID: Found an invalid byte in the input. The "buf"
- * member of the parser object will point at the invalid byte.
+ * member of the parser object will point at the invalid byte, so its
+ * offset from the start of the input is the error position. A string
+ * length prefix too large for a size_t is also invalid, with "buf" at
+ * the start of the prefix.
  *
  * BENCODE_ERROR_EOF: The input was exhausted early, indicating
- * truncated input.
+ * truncated input that more bytes could complete. The parser state is
+ * left unchanged, so if more input arrives, call bencode_extend() and
+ * then bencode_next() again. A string whose length prefix fits in a
+ * size_t but exceeds what the caller can buffer is still reported this
+ * way, so a reader should bound its input.
  *
  * BENCODE_ERROR_BAD_KEY: An invalid key was found while parsing a
  * dictionary. The key is either a duplicate or not properly sorted. The
- * offending key can be found in the "tok" and "toklen" members.
+ * offending key can be found in the "tok" and "toklen" members, and
+ * "buf" points just past it.
  *
  * BENCODE_ERROR_OOM: The input was so deeply nested that the parser ran
  * of memory for the stack.
  */
 int bencode_next(struct bencode *);
 
+/**
+ * Append input after BENCODE_ERROR_EOF, for incremental parsing.
+ *
+ * The given number of new bytes have been stored immediately following
+ * the bytes already given to the parser. Earlier bytes must stay where
+ * they are, since returned tokens and the parser's record of previous
+ * keys point into them, unless the move is reported with
+ * bencode_rebase().
+ */
+void bencode_extend(struct bencode *, size_t);
+
+/**
+ * Follow the input buffer to a new address, for incremental parsing.
+ *
+ * Call this after moving the whole buffer given to bencode_init() or
+ * bencode_reinit(), e.g. with realloc() to make room for more input,
+ * passing its new start. Every pointer the parser holds into the input
+ * keeps its offset from the start, including "tok", "buf" and the
+ * record of previous keys. Tokens the caller kept from before the move
+ * must be adjusted the same way. Then continue with bencode_extend()
+ * and bencode_next() as usual.
+ */
+void bencode_rebase(struct bencode *, const void *);
+
+/**
+ * Resynchronize after an error to salvage the rest of the input.
+ *
+ * Call this with the error after bencode_next() returns
+ * BENCODE_ERROR_INVALID or BENCODE_ERROR_BAD_KEY, then continue with
+ * bencode_next(). Record the error's position from the "buf" member
+ * first, as described for each error under bencode_next(). After
+ * BENCODE_ERROR_BAD_KEY the rejected key's value is skipped. Otherwise,
+ * or if that value is damaged too, input is discarded up to the next
+ * position within the current container where a well-formed element
+ * starts, using string length prefixes to check candidate strings. The
+ * scan is linear in the input skipped. In a dictionary parsing resumes
+ * with a key, so a key may go without a value. Trailing garbage after a
+ * complete top-level value is dropped.
+ *
+ * Returns BENCODE_DONE when parsing may continue, BENCODE_ERROR_EOF if
+ * no boundary was found before the end of input, or BENCODE_ERROR_OOM.
+ * The next call to bencode_next() always makes progress, so a loop
+ * alternating between the two functions terminates.
+ */
+int bencode_recover(struct bencode *, int);
+
+/**
+ * Write the canonical encoding of the entire input to a buffer.
+ *
+ * Use this on a freshly initialized decoder. The input is parsed as if
+ * BENCODE_OPTION_UNSORTED were set, and dictionaries with unsorted keys
+ * are rewritten with their entries in sorted order. The output buffer
+ * must be at least as large as the input, since the canonical encoding
+ * always has exactly the same length. Already-sorted input is copied
+ * through unchanged.
+ *
+ * Returns BENCODE_DONE on success, or one of the bencode_next() errors.
+ * A duplicate key is reported as BENCODE_ERROR_BAD_KEY, with the key in
+ * the "tok" and "toklen" members. The output buffer contents are
+ * unspecified after an error.
+ */
+int bencode_canonicalize(struct bencode *, void *);
+
+/**
+ * Find the span of the value at a path of dictionary keys.
+ *
+ * Use this on a freshly initialized decoder. The path is an array of
+ * null-terminated keys ending with a null pointer. Each key but the
+ * last must name a dictionary. The entire input is validated in the
+ * same single pass.
+ *
+ * On success the value occupies the bytes from the offset stored in
+ * the first size_t for the length stored in the second, and the value's
+ * type is returned: BENCODE_INTEGER, BENCODE_STRING, BENCODE_LIST_BEGIN
+ * or BENCODE_DICT_BEGIN. An edited document is the input before the
+ * span, followed by the new encoded value, followed by the input after
+ * the span. These three pieces may be written as a gather list without
+ * copying the input.
+ *
+ * If only the last key is missing, BENCODE_DONE is returned and the
+ * offset is where a new entry, key and value, must be inserted to keep
+ * the dictionary sorted. The length is zero. With
+ * BENCODE_OPTION_UNSORTED set the dictionary may not be sorted to begin
+ * with, so the offset is instead just before its terminating 'e', and
+ * the result is not canonical.
+ *
+ * Returns BENCODE_ERROR_NOT_FOUND if an earlier key is missing or does
+ * not name a dictionary, or one of the bencode_next() errors.
+ */
+int bencode_locate(struct bencode *, const char *const *, size_t *, size_t *);
+
 #endif
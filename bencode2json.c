@@ -0,0 +1,50 @@
+/* Bencode to JSON transcoder
+ *
+ * Reads bencode on standard input and writes JSON on standard output.
+ * Strings that are not UTF-8 are tagged and encoded according to the
+ * -e (the default), -x, or -b option, as described in json.h, so the
+ * output can be converted back exactly with json2bencode.
+ *
+ * On invalid input the exit status is nonzero and standard output
+ * holds an incomplete JSON prefix, possibly empty, which must be
+ * discarded.
+ *
+ * This is free and unencumbered software released into the public domain.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "json.h"
+
+static void
+usage(FILE *f)
+{
+    fprintf(f, "usage: bencode2json [-b|-e|-x] <INPUT >OUTPUT\n");
+    fprintf(f, "  -b   tag non-UTF-8 strings \\u0000base64:\n");
+    fprintf(f, "  -e   tag non-UTF-8 strings \\u0000bytes: (default)\n");
+    fprintf(f, "  -x   tag non-UTF-8 strings \\u0000hex:\n");
+}
+
+int
+main(int argc, char **argv)
+{
+    int i;
+    int mode = JSON_ESCAPE;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-b")) {
+            mode = JSON_BASE64;
+        } else if (!strcmp(argv[i], "-e")) {
+            mode = JSON_ESCAPE;
+        } else if (!strcmp(argv[i], "-x")) {
+            mode = JSON_HEX;
+        } else if (!strcmp(argv[i], "-h")) {
+            usage(stdout);
+            return EXIT_SUCCESS;
+        } else {
+            usage(stderr);
+            return EXIT_FAILURE;
+        }
+    }
+    return bencode2json(stdin, stdout, mode) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,827 @@
+/* Bencode/JSON transcoding, see json.h
+ *
+ * This is free and unencumbered software released into the public domain.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "bencode.h"
+#include "json.h"
+
+struct out {
+    FILE *f;
+    char *buf;
+    size_t len;
+    size_t cap;
+};
+
+/* Name of the running conversion, for messages */
+static const char *progname;
+
+static void
+fatal(const char *msg)
+{
+    fprintf(stderr, "%s: %s\n", progname, msg);
+    exit(EXIT_FAILURE);
+}
+
+static void
+out_flush(struct out *o)
+{
+    if (o->len && !fwrite(o->buf, o->len, 1, o->f))
+        fatal("write error");
+    o->len = 0;
+}
+
+/* Reserve room for at least n more bytes, flushing or growing. An
+ * output without a stream only grows, keeping everything written. */
+static char *
+out_reserve(struct out *o, size_t n)
+{
+    if (o->cap - o->len < n) {
+        if (o->f)
+            out_flush(o);
+        if (o->cap - o->len < n) {
+            size_t newcap = o->cap ? o->cap : 1 << 16;
+            while (newcap - o->len < n) {
+                newcap *= 2;
+                if (!newcap) fatal("out of memory");
+            }
+            o->buf = realloc(o->buf, newcap);
+            if (!o->buf) fatal("out of memory");
+            o->cap = newcap;
+        }
+    }
+    return o->buf + o->len;
+}
+
+static void
+out_write(struct out *o, const void *buf, size_t len)
+{
+    if (!len)
+        return;
+    memcpy(out_reserve(o, len), buf, len);
+    o->len += len;
+}
+
+static void
+out_byte(struct out *o, int c)
+{
+    *out_reserve(o, 1) = c;
+    o->len++;
+}
+
+/* Return the length of the valid UTF-8 sequence at p, or 0. */
+static size_t
+utf8_seqlen(const unsigned char *p, size_t len)
+{
+    unsigned long c;
+    size_t i, n;
+    if (p[0] < 0x80) {
+        return 1;
+    } else if ((p[0] & 0xe0) == 0xc0) {
+        n = 2;
+        c = p[0] & 0x1f;
+    } else if ((p[0] & 0xf0) == 0xe0) {
+        n = 3;
+        c = p[0] & 0x0f;
+    } else if ((p[0] & 0xf8) == 0xf0) {
+        n = 4;
+        c = p[0] & 0x07;
+    } else {
+        return 0;
+    }
+    if (len < n)
+        return 0;
+    for (i = 1; i < n; i++) {
+        if ((p[i] & 0xc0) != 0x80)
+            return 0;
+        c = c << 6 | (p[i] & 0x3f);
+    }
+    if (n == 2 && c < 0x80)
+        return 0; /* overlong */
+    if (n == 3 && (c < 0x800 || (c >= 0xd800 && c <= 0xdfff)))
+        return 0; /* overlong or surrogate */
+    if (n == 4 && (c < 0x10000 || c > 0x10ffff))
+        return 0; /* overlong or out of range */
+    return n;
+}
+
+static int
+utf8_valid(const unsigned char *p, size_t len)
+{
+    while (len) {
+        size_t n;
+        /* Skip ASCII a word at a time */
+        while (len >= sizeof(unsigned long)) {
+            unsigned long w;
+            memcpy(&w, p, sizeof(w));
+            if (w & (unsigned long)-1 / 0xff * 0x80)
+                break;
+            p += sizeof(unsigned long);
+            len -= sizeof(unsigned long);
+        }
+        if (!len)
+            break;
+        n = utf8_seqlen(p, len);
+        if (!n)
+            return 0;
+        p += n;
+        len -= n;
+    }
+    return 1;
+}
+
+/* Nonzero for bytes that cannot appear literally in a JSON string. */
+static const unsigned char json_special[256] = {
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1
+};
+
+static const char hexdigits[] = "0123456789abcdef";
+
+/* Write the escape for byte c to d, returning its length. */
+static size_t
+json_escape(char *d, int c)
+{
+    switch (c) {
+        case 0x22: memcpy(d, "\\\"", 2); return 2;
+        case 0x5c: memcpy(d, "\\\\", 2); return 2;
+        case 0x08: memcpy(d, "\\b", 2); return 2;
+        case 0x0c: memcpy(d, "\\f", 2); return 2;
+        case 0x0a: memcpy(d, "\\n", 2); return 2;
+        case 0x0d: memcpy(d, "\\r", 2); return 2;
+        case 0x09: memcpy(d, "\\t", 2); return 2;
+    }
+    memcpy(d, "\\u00", 4);
+    d[4] = hexdigits[c >> 4];
+    d[5] = hexdigits[c & 15];
+    return 6;
+}
+
+/* Write UTF-8 text as a JSON string body, copying safe runs whole. */
+static void
+json_text(struct out *o, const unsigned char *p, size_t len)
+{
+    while (len) {
+        size_t run = 0;
+        while (run < len && !json_special[p[run]])
+            run++;
+        out_write(o, p, run);
+        p += run;
+        len -= run;
+        if (!len)
+            break;
+        o->len += json_escape(out_reserve(o, 6), *p++);
+        len--;
+    }
+}
+
+/* Escapes for json_bytes(), each followed by its length. */
+static char byte_escapes[256][7];
+
+static void
+json_init(void)
+{
+    int c;
+    for (c = 0; c < 256; c++) {
+        if (c < 0x80 && !json_special[c]) {
+            byte_escapes[c][0] = c;
+            byte_escapes[c][6] = 1;
+        } else {
+            byte_escapes[c][6] = json_escape(byte_escapes[c], c);
+        }
+    }
+}
+
+/* Write arbitrary bytes as a JSON string body, each byte as U+00XX. */
+static void
+json_bytes(struct out *o, const unsigned char *p, size_t len)
+{
+    while (len) {
+        /* Escape in blocks with room for the worst case reserved */
+        size_t i, n = len < 4096 ? len : 4096;
+        char *d = out_reserve(o, n * 6);
+        char *start = d;
+        for (i = 0; i < n; i++) {
+            /* Copy all six bytes, keep only the escape's length */
+            memcpy(d, byte_escapes[p[i]], 6);
+            d += byte_escapes[p[i]][6];
+        }
+        o->len += d - start;
+        p += n;
+        len -= n;
+    }
+}
+
+static void
+json_hex(struct out *o, const unsigned char *p, size_t len)
+{
+    size_t i;
+    char *d = out_reserve(o, len * 2);
+    for (i = 0; i < len; i++) {
+        d[i * 2 + 0] = hexdigits[p[i] >> 4];
+        d[i * 2 + 1] = hexdigits[p[i] & 15];
+    }
+    o->len += len * 2;
+}
+
+static void
+json_base64(struct out *o, const unsigned char *p, size_t len)
+{
+    static const char b64[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char *d = out_reserve(o, (len + 2) / 3 * 4);
+    for (; len >= 3; p += 3, len -= 3) {
+        unsigned long v = (unsigned long)p[0] << 16 | p[1] << 8 | p[2];
+        *d++ = b64[v >> 18 & 63];
+        *d++ = b64[v >> 12 & 63];
+        *d++ = b64[v >>  6 & 63];
+        *d++ = b64[v >>  0 & 63];
+        o->len += 4;
+    }
+    if (len) {
+        unsigned long v = (unsigned long)p[0] << 16;
+        if (len == 2)
+            v |= p[1] << 8;
+        *d++ = b64[v >> 18 & 63];
+        *d++ = b64[v >> 12 & 63];
+        *d++ = len == 2 ? b64[v >> 6 & 63] : 0x3d; /* = */
+        *d++ = 0x3d;
+        o->len += 4;
+    }
+}
+
+static void
+json_string(struct out *o, const void *buf, size_t len, int mode)
+{
+    const unsigned char *p = buf;
+    out_byte(o, 0x22);
+    if ((!len || p[0]) && utf8_valid(p, len)) {
+        json_text(o, p, len);
+    } else {
+        /* Tagged so that it cannot be mistaken for a plain string */
+        switch (mode) {
+            case JSON_ESCAPE:
+                out_write(o, "\\u0000bytes:", 12);
+                json_bytes(o, p, len);
+                break;
+            case JSON_HEX:
+                out_write(o, "\\u0000hex:", 10);
+                json_hex(o, p, len);
+                break;
+            case JSON_BASE64:
+                out_write(o, "\\u0000base64:", 13);
+                json_base64(o, p, len);
+                break;
+        }
+    }
+    out_byte(o, 0x22);
+}
+
+/* Read a whole stream into a new buffer. */
+static char *
+slurp(FILE *in, size_t *plen)
+{
+    char *buf = 0;
+    size_t len = 0;
+    size_t cap = 0;
+    size_t n;
+    for (;;) {
+        if (len == cap) {
+            cap = cap ? cap * 2 : 1 << 16;
+            if (!cap) fatal("out of memory");
+            buf = realloc(buf, cap);
+            if (!buf) fatal("out of memory");
+        }
+        n = fread(buf + len, 1, cap - len, in);
+        if (!n)
+            break;
+        len += n;
+    }
+    if (ferror(in))
+        fatal("read error");
+    *plen = len;
+    return buf;
+}
+
+int
+bencode2json(FILE *in, FILE *f, int mode)
+{
+    int r;
+    size_t len;
+    char *buf;
+    struct bencode ctx[1];
+    struct out out[1] = {{0, 0, 0, 0}};
+
+    progname = "bencode2json";
+    buf = slurp(in, &len);
+    out->f = f;
+    json_init();
+    bencode_init(ctx, buf, len);
+    for (;;) {
+        int first = BENCODE_FIRST(ctx);
+        int isvalue = BENCODE_IS_VALUE(ctx);
+        r = bencode_next(ctx);
+        if (r < 0) {
+            out->len = 0; /* drop the unwritten part of the prefix */
+            fprintf(stderr, "%s: %s at byte %lu\n", progname,
+                    r == BENCODE_ERROR_OOM     ? "out of memory" :
+                    r == BENCODE_ERROR_BAD_KEY ? "invalid key" :
+                    r == BENCODE_ERROR_EOF     ? "premature end of input" :
+                                                 "invalid input",
+                    (unsigned long)((char *)ctx->buf - buf));
+            break;
+        }
+        if (r == BENCODE_DONE)
+            break;
+        if (r != BENCODE_LIST_END && r != BENCODE_DICT_END) {
+            if (isvalue)
+                out_byte(out, 0x3a); /* : */
+            else if (!first)
+                out_byte(out, 0x2c); /* , */
+        }
+        switch (r) {
+            case BENCODE_INTEGER:
+                out_write(out, ctx->tok, ctx->toklen);
+                break;
+            case BENCODE_STRING:
+                json_string(out, ctx->tok, ctx->toklen, mode);
+                break;
+            case BENCODE_LIST_BEGIN: out_byte(out, 0x5b); break; /* [ */
+            case BENCODE_LIST_END:   out_byte(out, 0x5d); break; /* ] */
+            case BENCODE_DICT_BEGIN: out_byte(out, 0x7b); break; /* { */
+            case BENCODE_DICT_END:   out_byte(out, 0x7d); break; /* } */
+        }
+    }
+    if (r == BENCODE_DONE) {
+        out_byte(out, 0x0a);
+        out_flush(out);
+    }
+
+    bencode_free(ctx);
+    free(out->buf);
+    free(buf);
+    return r == BENCODE_DONE ? 0 : -1;
+}
+
+/* JSON to bencode */
+
+struct entry {
+    size_t off;     /* start of the encoded key in the output */
+    size_t len;     /* length of the encoded key and value */
+    size_t keyoff;  /* start of the key's bytes */
+    size_t keylen;
+};
+
+struct frame {
+    int dict;
+    size_t first;   /* index of the container's first entry */
+};
+
+struct parser {
+    const unsigned char *p;
+    const unsigned char *end;
+    const char *error;
+    struct out doc;
+    struct out tmp;
+    struct entry *entries;
+    size_t nentries;
+    size_t capentries;
+    struct frame *frames;
+    size_t nframes;
+    size_t capframes;
+};
+
+static void *
+grow(void *p, size_t *cap, size_t size)
+{
+    size_t newcap = *cap ? *cap * 2 : 64;
+    if (newcap < *cap || newcap * size / size != newcap)
+        fatal("out of memory");
+    p = realloc(p, newcap * size);
+    if (!p) fatal("out of memory");
+    *cap = newcap;
+    return p;
+}
+
+static int
+fail(struct parser *ps, const char *error)
+{
+    ps->error = error;
+    return -1;
+}
+
+static void
+skip_space(struct parser *ps)
+{
+    while (ps->p < ps->end && (*ps->p == 0x20 || *ps->p == 0x09 ||
+                               *ps->p == 0x0a || *ps->p == 0x0d))
+        ps->p++;
+}
+
+/* Digit values for hex and base64 decoding, -1 for other bytes */
+static signed char hexvalues[256];
+static signed char b64values[256];
+
+static void
+json_decode_init(void)
+{
+    static const char b64[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    int i;
+    memset(hexvalues, -1, sizeof(hexvalues));
+    memset(b64values, -1, sizeof(b64values));
+    for (i = 0; i < 16; i++) {
+        hexvalues[(unsigned char)hexdigits[i]] = i;
+        hexvalues[(unsigned char)"0123456789ABCDEF"[i]] = i;
+    }
+    for (i = 0; i < 64; i++)
+        b64values[(unsigned char)b64[i]] = i;
+}
+
+/* Read the four hex digits of a \u escape. */
+static long
+read_u16(struct parser *ps)
+{
+    long v = 0;
+    int i;
+    if (ps->end - ps->p < 4)
+        return -1;
+    for (i = 0; i < 4; i++) {
+        int d = hexvalues[*ps->p++];
+        if (d < 0)
+            return -1;
+        v = v << 4 | d;
+    }
+    return v;
+}
+
+static void
+put_utf8(struct out *o, unsigned long c)
+{
+    char *d = out_reserve(o, 4);
+    if (c < 0x80) {
+        d[0] = c;
+        o->len += 1;
+    } else if (c < 0x800) {
+        d[0] = 0xc0 | c >> 6;
+        d[1] = 0x80 | (c & 0x3f);
+        o->len += 2;
+    } else if (c < 0x10000) {
+        d[0] = 0xe0 | c >> 12;
+        d[1] = 0x80 | (c >> 6 & 0x3f);
+        d[2] = 0x80 | (c & 0x3f);
+        o->len += 3;
+    } else {
+        d[0] = 0xf0 | c >> 18;
+        d[1] = 0x80 | (c >> 12 & 0x3f);
+        d[2] = 0x80 | (c >> 6 & 0x3f);
+        d[3] = 0x80 | (c & 0x3f);
+        o->len += 4;
+    }
+}
+
+/* Decode the JSON string at the input into UTF-8 in ps->tmp. */
+static int
+read_text(struct parser *ps)
+{
+    ps->tmp.len = 0;
+    ps->p++; /* opening quote */
+    for (;;) {
+        const unsigned char *run = ps->p;
+        unsigned long c;
+        while (ps->p < ps->end && (!json_special[*ps->p] || *ps->p == 0x7f))
+            ps->p++;
+        if (ps->p != run) {
+            if (!utf8_valid(run, ps->p - run))
+                return fail(ps, "invalid UTF-8");
+            out_write(&ps->tmp, run, ps->p - run);
+        }
+        if (ps->p == ps->end)
+            return fail(ps, "unterminated string");
+        c = *ps->p++;
+        if (c == 0x22) /* " */
+            return 0;
+        if (c != 0x5c) /* \ */
+            return fail(ps, "control character in string");
+        if (ps->p == ps->end)
+            return fail(ps, "unterminated string");
+        switch (*ps->p++) {
+            case 0x22: c = 0x22; break; /* \" */
+            case 0x5c: c = 0x5c; break; /* \\ */
+            case 0x2f: c = 0x2f; break; /* \/ */
+            case 0x62: c = 0x08; break; /* \b */
+            case 0x66: c = 0x0c; break; /* \f */
+            case 0x6e: c = 0x0a; break; /* \n */
+            case 0x72: c = 0x0d; break; /* \r */
+            case 0x74: c = 0x09; break; /* \t */
+            case 0x75: { /* \u */
+                long hi = read_u16(ps), lo;
+                if (hi < 0)
+                    return fail(ps, "invalid \\u escape");
+                c = hi;
+                if (hi >= 0xdc00 && hi <= 0xdfff)
+                    return fail(ps, "unpaired surrogate");
+                if (hi >= 0xd800 && hi <= 0xdbff) {
+                    if (ps->end - ps->p < 2 || ps->p[0] != 0x5c ||
+                        ps->p[1] != 0x75)
+                        return fail(ps, "unpaired surrogate");
+                    ps->p += 2;
+                    lo = read_u16(ps);
+                    if (lo < 0xdc00 || lo > 0xdfff)
+                        return fail(ps, "unpaired surrogate");
+                    c = 0x10000 + ((hi - 0xd800) << 10) + (lo - 0xdc00);
+                }
+            } break;
+            default:
+                return fail(ps, "invalid escape");
+        }
+        put_utf8(&ps->tmp, c);
+    }
+}
+
+/* Replace a tagged string in ps->tmp with the bytes it encodes. */
+static int
+untag(struct parser *ps)
+{
+    unsigned char *s = (unsigned char *)ps->tmp.buf;
+    size_t len = ps->tmp.len;
+    size_t i, n = 0;
+    unsigned char *body = memchr(s, 0x3a, len);  /* : */
+    size_t taglen = body ? body - s - 1 : 0;
+    size_t blen;
+
+    if (!body)
+        return fail(ps, "untagged string begins with U+0000");
+    body++;
+    blen = len - (body - s);
+    if (taglen == 5 && !memcmp(s + 1, "bytes", 5)) {
+        /* Code points U+0000 to U+00FF, one or two bytes of UTF-8 */
+        for (i = 0; i < blen; i++) {
+            if (body[i] < 0x80) {
+                s[n++] = body[i];
+            } else if ((body[i] == 0xc2 || body[i] == 0xc3) && i + 1 < blen) {
+                s[n++] = (body[i] & 0x03) << 6 | (body[i + 1] & 0x3f);
+                i++;
+            } else {
+                return fail(ps, "code point above U+00FF in bytes string");
+            }
+        }
+    } else if (taglen == 3 && !memcmp(s + 1, "hex", 3)) {
+        if (blen % 2)
+            return fail(ps, "odd length hex string");
+        for (i = 0; i < blen; i += 2) {
+            int hi = hexvalues[body[i]];
+            int lo = hexvalues[body[i + 1]];
+            if (hi < 0 || lo < 0)
+                return fail(ps, "invalid hex string");
+            s[n++] = hi << 4 | lo;
+        }
+    } else if (taglen == 6 && !memcmp(s + 1, "base64", 6)) {
+        if (blen % 4)
+            return fail(ps, "invalid base64 string");
+        for (i = 0; i < blen; i += 4) {
+            unsigned long v = 0;
+            int j, pad = 0;
+            for (j = 0; j < 4; j++) {
+                int d = b64values[body[i + j]];
+                if (body[i + j] == 0x3d && i + 4 == blen && j >= 2) /* = */
+                    pad++;
+                else if (pad || d < 0)
+                    return fail(ps, "invalid base64 string");
+                v = v << 6 | (d < 0 ? 0 : d);
+            }
+            s[n++] = v >> 16 & 0xff;
+            if (pad < 2)
+                s[n++] = v >> 8 & 0xff;
+            if (pad < 1)
+                s[n++] = v & 0xff;
+        }
+    } else {
+        return fail(ps, "unknown string tag");
+    }
+    ps->tmp.len = n;
+    return 0;
+}
+
+/* Write the JSON string at the input as a bencode string. */
+static int
+put_string(struct parser *ps)
+{
+    char prefix[32];
+    if (read_text(ps))
+        return -1;
+    if (ps->tmp.len && !ps->tmp.buf[0] && untag(ps))
+        return -1;
+    sprintf(prefix, "%lu:", (unsigned long)ps->tmp.len);
+    out_write(&ps->doc, prefix, strlen(prefix));
+    out_write(&ps->doc, ps->tmp.buf, ps->tmp.len);
+    return 0;
+}
+
+/* Write the JSON number at the input, which must be an integer. */
+static int
+put_integer(struct parser *ps)
+{
+    const unsigned char *start = ps->p;
+    if (ps->p < ps->end && *ps->p == 0x2d) /* - */
+        ps->p++;
+    if (ps->p == ps->end || *ps->p < 0x30 || *ps->p > 0x39)
+        return fail(ps, "invalid number");
+    if (*ps->p == 0x30) { /* 0 */
+        ps->p++;
+        if (ps->p - start == 2)
+            return fail(ps, "negative zero");
+    } else {
+        while (ps->p < ps->end && *ps->p >= 0x30 && *ps->p <= 0x39)
+            ps->p++;
+    }
+    if (ps->p < ps->end &&
+        (*ps->p == 0x2e || *ps->p == 0x65 || *ps->p == 0x45)) /* . e E */
+        return fail(ps, "number is not an integer");
+    out_byte(&ps->doc, 0x69); /* i */
+    out_write(&ps->doc, start, ps->p - start);
+    out_byte(&ps->doc, 0x65); /* e */
+    return 0;
+}
+
+/* Output buffer used by entrycmp(), since qsort() takes no context */
+static const char *sortbase;
+
+static int
+entrycmp(const void *pa, const void *pb)
+{
+    const struct entry *a = pa;
+    const struct entry *b = pb;
+    size_t n = a->keylen < b->keylen ? a->keylen : b->keylen;
+    int r = memcmp(sortbase + a->keyoff, sortbase + b->keyoff, n);
+    if (r)
+        return r;
+    return a->keylen < b->keylen ? -1 : a->keylen > b->keylen;
+}
+
+/* Put the entries of the dictionary just closed into key order. */
+static int
+sort_entries(struct parser *ps, size_t first)
+{
+    size_t i, n = ps->nentries - first;
+    struct entry *e = ps->entries + first;
+    size_t start, sorted = 1;
+
+    if (!n)
+        return 0;
+    e[n - 1].len = ps->doc.len - e[n - 1].off;
+    sortbase = ps->doc.buf;
+    for (i = 1; i < n; i++)
+        if (entrycmp(e + i - 1, e + i) >= 0)
+            sorted = 0;
+    if (sorted)
+        return 0;
+
+    qsort(e, n, sizeof(*e), entrycmp);
+    for (i = 1; i < n; i++)
+        if (!entrycmp(e + i - 1, e + i))
+            return fail(ps, "duplicate key");
+
+    /* Gather the entries in order, then copy them back in place */
+    start = ps->doc.len;
+    for (i = 0; i < n; i++)
+        if (e[i].off < start)
+            start = e[i].off;
+    ps->tmp.len = 0;
+    for (i = 0; i < n; i++)
+        out_write(&ps->tmp, ps->doc.buf + e[i].off, e[i].len);
+    memcpy(ps->doc.buf + start, ps->tmp.buf, ps->tmp.len);
+    return 0;
+}
+
+/* Begin a dictionary entry with the key at the input. */
+static int
+put_key(struct parser *ps)
+{
+    struct entry *e;
+    size_t off = ps->doc.len;
+    skip_space(ps);
+    if (ps->p == ps->end || *ps->p != 0x22)
+        return fail(ps, "expected a string key");
+    if (put_string(ps))
+        return -1;
+    if (ps->nentries == ps->capentries)
+        ps->entries = grow(ps->entries, &ps->capentries, sizeof(*e));
+    e = ps->entries + ps->nentries++;
+    e->off = off;
+    e->keylen = ps->tmp.len;
+    e->keyoff = ps->doc.len - e->keylen;
+    if (e != ps->entries + ps->frames[ps->nframes - 1].first)
+        e[-1].len = off - e[-1].off;
+    skip_space(ps);
+    if (ps->p == ps->end || *ps->p != 0x3a) /* : */
+        return fail(ps, "expected ':'");
+    ps->p++;
+    return 0;
+}
+
+static int
+json_parse(struct parser *ps)
+{
+    for (;;) {
+        /* A value */
+        skip_space(ps);
+        if (ps->p == ps->end)
+            return fail(ps, "premature end of input");
+        switch (*ps->p) {
+            case 0x7b: /* { */
+            case 0x5b: /* [ */
+                if (ps->nframes == ps->capframes)
+                    ps->frames = grow(ps->frames, &ps->capframes,
+                                      sizeof(*ps->frames));
+                ps->frames[ps->nframes].dict = *ps->p == 0x7b;
+                ps->frames[ps->nframes].first = ps->nentries;
+                ps->nframes++;
+                out_byte(&ps->doc, *ps->p == 0x7b ? 0x64 : 0x6c); /* d l */
+                ps->p++;
+                skip_space(ps);
+                if (ps->p < ps->end && (*ps->p == 0x7d || *ps->p == 0x5d))
+                    break; /* empty, closed below */
+                if (ps->frames[ps->nframes - 1].dict && put_key(ps))
+                    return -1;
+                continue;
+            case 0x22: /* " */
+                if (put_string(ps))
+                    return -1;
+                break;
+            default:
+                if (*ps->p != 0x2d && (*ps->p < 0x30 || *ps->p > 0x39))
+                    return fail(ps, "unexpected character");
+                if (put_integer(ps))
+                    return -1;
+        }
+
+        /* Close containers until another value is due */
+        for (;;) {
+            struct frame *f;
+            skip_space(ps);
+            if (!ps->nframes) {
+                if (ps->p != ps->end)
+                    return fail(ps, "trailing garbage");
+                return 0;
+            }
+            if (ps->p == ps->end)
+                return fail(ps, "premature end of input");
+            f = ps->frames + ps->nframes - 1;
+            if (*ps->p == 0x2c) { /* , */
+                ps->p++;
+                if (f->dict && put_key(ps))
+                    return -1;
+                break;
+            }
+            if (*ps->p != (f->dict ? 0x7d : 0x5d)) /* } ] */
+                return fail(ps, f->dict ? "expected ',' or '}'"
+                                        : "expected ',' or ']'");
+            ps->p++;
+            if (f->dict) {
+                if (sort_entries(ps, f->first))
+                    return -1;
+                ps->nentries = f->first;
+            }
+            out_byte(&ps->doc, 0x65); /* e */
+            ps->nframes--;
+        }
+    }
+}
+
+int
+json2bencode(FILE *in, FILE *f)
+{
+    int r;
+    size_t len;
+    char *buf;
+    struct parser ps[1] = {{0, 0, 0, {0, 0, 0, 0}, {0, 0, 0, 0}}};
+
+    progname = "json2bencode";
+    buf = slurp(in, &len);
+    json_decode_init();
+    ps->p = (unsigned char *)buf;
+    ps->end = ps->p + len;
+    r = json_parse(ps);
+    if (r) {
+        fprintf(stderr, "%s: %s at byte %lu\n", progname, ps->error,
+                (unsigned long)((char *)ps->p - buf));
+    } else {
+        ps->doc.f = f;
+        out_flush(&ps->doc);
+    }
+
+    free(ps->doc.buf);
+    free(ps->tmp.buf);
+    free(ps->entries);
+    free(ps->frames);
+    free(buf);
+    return r;
+}
@@ -0,0 +1,54 @@
+/* Bencode/JSON transcoding in both directions
+ *
+ * Strings, including dictionary keys, that are valid UTF-8 and do not
+ * begin with a null byte become JSON strings as they are. Any other
+ * string becomes U+0000, a tag naming its encoding, a colon, and its
+ * bytes encoded according to the mode:
+ *
+ *   JSON_ESCAPE  "\u0000bytes:..."   each byte as the equal code point
+ *   JSON_HEX     "\u0000hex:..."     lowercase hex, two digits per byte
+ *   JSON_BASE64  "\u0000base64:..."  standard base64 with padding
+ *
+ * No plain string begins with U+0000, so a reader can always tell the
+ * two apart and recover the original bytes exactly.
+ *
+ * This is free and unencumbered software released into the public domain.
+ */
+#ifndef JSON_H
+#define JSON_H
+
+#include <stdio.h>
+
+#define JSON_ESCAPE 0
+#define JSON_HEX    1
+#define JSON_BASE64 2
+
+/**
+ * Transcode one bencode value from one stream to JSON on another.
+ *
+ * The whole input is read first. Output is written in blocks as it is
+ * produced. On invalid input an error with its byte offset is printed
+ * to standard error and the output holds an incomplete JSON prefix,
+ * possibly empty, which must be discarded. Exits the program on
+ * allocation or I/O failure.
+ *
+ * Returns 0 on success, or -1 on invalid input.
+ */
+int bencode2json(FILE *in, FILE *out, int mode);
+
+/**
+ * Transcode one JSON value from one stream to bencode on another.
+ *
+ * This is the inverse of bencode2json() in every mode: tagged strings
+ * are decoded back to their bytes, and object members are sorted into
+ * dictionary key order, so the output is canonical bencode. Numbers
+ * must be integers, and true, false and null have no bencode form. The
+ * output is written only once the whole input has been converted. On
+ * invalid input, an error with its byte offset is printed to standard
+ * error. Exits the program on allocation or I/O failure.
+ *
+ * Returns 0 on success, or -1 on invalid input.
+ */
+int json2bencode(FILE *in, FILE *out);
+
+#endif
@@ -0,0 +1,27 @@
+/* JSON to bencode transcoder
+ *
+ * Reads JSON on standard input and writes canonical bencode on standard
+ * output, reversing bencode2json in any of its modes, as described in
+ * json.h. Object members may come in any order, but keys must be
+ * unique once decoded.
+ *
+ * On invalid input the exit status is nonzero and nothing is written.
+ *
+ * This is free and unencumbered software released into the public domain.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "json.h"
+
+int
+main(int argc, char **argv)
+{
+    if (argc > 1) {
+        int help = !strcmp(argv[1], "-h");
+        fprintf(help ? stdout : stderr,
+                "usage: json2bencode <INPUT >OUTPUT\n");
+        return help ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    return json2bencode(stdin, stdout) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
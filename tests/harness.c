@@ -0,0 +1,661 @@
+/* Differential and performance regression harness
+ *
+ * Generates a seeded random corpus of valid and invalid bencode, runs
+ * each parsing mode over it, and checks that every mode produces the
+ * same token stream and error positions as plain bencode_next(), and
+ * the same key IDs as a binary search of the key set. Modes that may
+ * diverge after an error must still match exactly on undamaged
+ * documents. Error recovery must also stay within a per-byte time
+ * bound over pathological damaged documents. Then
+ * times each mode relative to plain bencode_next() and compares these
+ * ratios against a baseline file of "name ratio" lines. Exits with
+ * failure on any mismatch, or when a ratio exceeds its baseline by
+ * more than the threshold. Engines are timed in interleaved rounds and
+ * each ratio is the median over all rounds, so drift in machine load
+ * affects every engine alike. Since the ratios cannot catch a slowdown
+ * of plain bencode_next() itself, its time is also divided by that of a
+ * fixed byte-at-a-time pass over the corpus, which tracks the machine
+ * rather than the parser, and checked against the "calibrated" line.
+ * Build without sanitizers for timing.
+ *
+ * Usage: harness [-s seed] [-n count] [-r rounds] [-t threshold] [-w]
+ *                [baseline]
+ *   -w  write measured ratios to the baseline file instead of checking
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../bencode.h"
+
+#if _WIN32
+#  define C_RED(s)   s
+#  define C_GREEN(s) s
+#  define C_BOLD(s)  s
+#else
+#  define C_RED(s)   "\033[31;1m" s "\033[0m"
+#  define C_GREEN(s) "\033[32;1m" s "\033[0m"
+#  define C_BOLD(s)  "\033[1m"    s "\033[0m"
+#endif
+
+#define countof(a) (sizeof(a) / sizeof(*a))
+
+/* Token stream record: type, offset and length of each token */
+struct token {
+    int type;
+    size_t off;
+    size_t len;
+};
+
+struct tape {
+    struct token *tokens;
+    size_t len;
+    size_t cap;
+};
+
+struct doc {
+    char *buf;
+    size_t len;
+    int damaged;
+};
+
+static unsigned long rng_state;
+
+/* Portable xorshift so corpora are identical across platforms. */
+static unsigned long
+rng(void)
+{
+    unsigned long x = rng_state;
+    x ^= x << 13 & 0xffffffffUL;
+    x ^= x >> 17;
+    x ^= x << 5 & 0xffffffffUL;
+    rng_state = x & 0xffffffffUL;
+    return rng_state;
+}
+
+static void *
+xrealloc(void *p, size_t size)
+{
+    p = realloc(p, size);
+    if (!p) {
+        fprintf(stderr, "harness: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static void
+emit(struct doc *d, size_t *cap, const void *buf, size_t len)
+{
+    if (d->len + len > *cap) {
+        while (d->len + len > *cap)
+            *cap = *cap ? *cap * 2 : 256;
+        d->buf = xrealloc(d->buf, *cap);
+    }
+    memcpy(d->buf + d->len, buf, len);
+    d->len += len;
+}
+
+static const char *const keyset[] = {
+    "a", "announce", "announce-list", "id", "info", "info_hash",
+    "length", "name", "piece length", "pieces", "private", "q", "t", "y"
+};
+
+static void
+gen_string(struct doc *d, size_t *cap, size_t maxlen)
+{
+    char prefix[32];
+    size_t i, len = rng() % (maxlen + 1);
+    sprintf(prefix, "%lu:", (unsigned long)len);
+    emit(d, cap, prefix, strlen(prefix));
+    for (i = 0; i < len; i++) {
+        char c = rng() % 4 ? 0x61 + rng() % 26 : rng() % 256;
+        emit(d, cap, &c, 1);
+    }
+}
+
+static int
+cmpkey(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static void
+gen_value(struct doc *d, size_t *cap, int depth)
+{
+    char tmp[32];
+    size_t i, n;
+    switch (rng() % (depth > 0 ? 5 : 2)) {
+        case 0:
+            sprintf(tmp, "i%lde", (long)(rng() % 2000001) - 1000000);
+            emit(d, cap, tmp, strlen(tmp));
+            break;
+        case 1:
+            gen_string(d, cap, rng() % 8 ? 16 : 4096);
+            break;
+        case 2:
+            /* Occasionally a deep chain of nested lists */
+            n = rng() % 32 ? 1 : 100 + rng() % 200;
+            for (i = 0; i < n; i++)
+                emit(d, cap, "l", 1);
+            for (i = rng() % 6; i; i--)
+                gen_value(d, cap, depth - 1);
+            for (i = 0; i < n; i++)
+                emit(d, cap, "e", 1);
+            break;
+        case 3:
+        case 4: {
+            /* Dictionary with a sorted subset of the key set */
+            const char *keys[countof(keyset)];
+            n = 0;
+            for (i = 0; i < countof(keyset); i++)
+                if (rng() % 3 == 0)
+                    keys[n++] = keyset[i];
+            qsort(keys, n, sizeof(*keys), cmpkey);
+            emit(d, cap, "d", 1);
+            for (i = 0; i < n; i++) {
+                sprintf(tmp, "%lu:", (unsigned long)strlen(keys[i]));
+                emit(d, cap, tmp, strlen(tmp));
+                emit(d, cap, keys[i], strlen(keys[i]));
+                gen_value(d, cap, depth - 1);
+            }
+            emit(d, cap, "e", 1);
+        }
+    }
+}
+
+/* Damage a document: flip, delete, insert, swap, or truncate. */
+static void
+mutate(struct doc *d, size_t *cap)
+{
+    size_t i = d->len ? rng() % d->len : 0;
+    switch (rng() % 5) {
+        case 0:
+            if (d->len)
+                d->buf[i] = rng() % 256;
+            break;
+        case 1:
+            if (d->len) {
+                memmove(d->buf + i, d->buf + i + 1, d->len - i - 1);
+                d->len--;
+            }
+            break;
+        case 2: {
+            static const char pick[] = "deil0123456789:-x";
+            char c = pick[rng() % (sizeof(pick) - 1)];
+            emit(d, cap, &c, 1);
+            memmove(d->buf + i + 1, d->buf + i, d->len - 1 - i);
+            d->buf[i] = c;
+        } break;
+        case 3:
+            if (d->len > 1 && i + 1 < d->len) {
+                char c = d->buf[i];
+                d->buf[i] = d->buf[i + 1];
+                d->buf[i + 1] = c;
+            }
+            break;
+        case 4:
+            d->len = i;
+    }
+}
+
+/* Damaged documents that defeat a naive byte-by-byte recovery scan */
+#define PATHOLOGICAL   5
+#define PATHOLOGY_SIZE (64UL * 1024)
+
+static void
+gen_pathological(struct doc *d, size_t *cap, int kind)
+{
+    size_t i;
+    emit(d, cap, kind == 4 ? "d" : "l", 1);
+    for (i = 0; i < PATHOLOGY_SIZE; i++) {
+        switch (kind) {
+            case 0: emit(d, cap, "9", 1); break;   /* digits, no colon */
+            case 1: emit(d, cap, "1", 1); break;   /* see below */
+            case 2: emit(d, cap, i ? "9" : "i", 1); break;
+            case 3: emit(d, cap, "-", 1); break;
+            case 4: emit(d, cap, i % 2 ? "x" : "1", 1);
+        }
+    }
+    if (kind == 1)
+        emit(d, cap, ":", 1); /* a run ending in a huge length prefix */
+    else
+        emit(d, cap, "xe", 2);
+    d->damaged = 1;
+}
+
+static void
+record(struct tape *t, int type, size_t off, size_t len)
+{
+    if (t->len == t->cap) {
+        t->cap = t->cap ? t->cap * 2 : 1024;
+        t->tokens = xrealloc(t->tokens, t->cap * sizeof(*t->tokens));
+    }
+    t->tokens[t->len].type = type;
+    t->tokens[t->len].off = off;
+    t->tokens[t->len].len = len;
+    t->len++;
+}
+
+/* Record a token, or an error with its input position. */
+static void
+record_result(struct tape *t, struct bencode *ctx, const char *buf, int r)
+{
+    if (r < 0)
+        record(t, r, (char *)ctx->buf - buf, 0);
+    else if (r == BENCODE_DONE || r == BENCODE_LIST_BEGIN ||
+             r == BENCODE_DICT_BEGIN)
+        record(t, r, 0, 0);
+    else
+        record(t, r, (char *)ctx->tok - buf, ctx->toklen);
+}
+
+/* Engines: each parses one document onto a tape */
+
+static void
+engine_reference(struct tape *t, struct bencode *ctx, const struct doc *d)
+{
+    int r;
+    bencode_reinit(ctx, d->buf, d->len);
+    do {
+        r = bencode_next(ctx);
+        record_result(t, ctx, d->buf, r);
+    } while (r > 0);
+}
+
+static void
+engine_incremental(struct tape *t, struct bencode *ctx, const struct doc *d)
+{
+    int r;
+    size_t fed = 0;
+    unsigned long seed = d->len;
+    bencode_reinit(ctx, d->buf, 0);
+    do {
+        r = bencode_next(ctx);
+        while ((r == BENCODE_ERROR_EOF || r == BENCODE_DONE) &&
+               fed < d->len) {
+            /* Deterministic pseudo-random chunk sizes, 1 to 64 bytes */
+            size_t n = ((seed = seed * 69069 + 1) >> 8 & 63) + 1;
+            n = n < d->len - fed ? n : d->len - fed;
+            bencode_extend(ctx, n);
+            fed += n;
+            r = bencode_next(ctx);
+        }
+        record_result(t, ctx, d->buf, r);
+    } while (r > 0);
+}
+
+/* Registered key set for the keys engine, sorted */
+static const char *const knownkeys[] = {
+    "announce", "id", "info", "info_hash", "name", "pieces", "q", "y"
+};
+
+/* Nonzero while checking correctness rather than timing */
+static int verify;
+
+/* Pseudo token type recorded when keyid disagrees with a lookup */
+#define TOKEN_BAD_KEYID 100
+
+struct keyref {
+    const char *buf;
+    size_t len;
+};
+
+static int
+cmpknown(const void *a, const void *b)
+{
+    const struct keyref *k = a;
+    const char *key = *(const char *const *)b;
+    size_t len = strlen(key);
+    int cmp = memcmp(k->buf, key, k->len < len ? k->len : len);
+    if (cmp)
+        return cmp;
+    return (k->len > len) - (k->len < len);
+}
+
+/* Return the keyid the parser should report for the last token. */
+static int
+expect_keyid(struct bencode *ctx, int r)
+{
+    const char *const *found;
+    struct keyref k;
+    if (r != BENCODE_STRING || !BENCODE_IS_VALUE(ctx))
+        return -1; /* not a dictionary key */
+    k.buf = ctx->tok;
+    k.len = ctx->toklen;
+    found = bsearch(&k, knownkeys, countof(knownkeys), sizeof(*knownkeys),
+                    cmpknown);
+    return found ? (int)(found - knownkeys) : -1;
+}
+
+static void
+engine_keys(struct tape *t, struct bencode *ctx, const struct doc *d)
+{
+    int r;
+    bencode_reinit(ctx, d->buf, d->len);
+    bencode_keys(ctx, knownkeys, countof(knownkeys));
+    do {
+        r = bencode_next(ctx);
+        if (verify && r > 0 && ctx->keyid != expect_keyid(ctx, r))
+            record(t, TOKEN_BAD_KEYID, (char *)ctx->tok - d->buf, 0);
+        else
+            record_result(t, ctx, d->buf, r);
+    } while (r > 0);
+    bencode_keys(ctx, 0, 0);
+}
+
+static void
+engine_unsorted(struct tape *t, struct bencode *ctx, const struct doc *d)
+{
+    int r;
+    bencode_reinit(ctx, d->buf, d->len);
+    ctx->options = BENCODE_OPTION_UNSORTED;
+    do {
+        r = bencode_next(ctx);
+        record_result(t, ctx, d->buf, r);
+    } while (r > 0);
+    ctx->options = 0;
+}
+
+static void
+engine_recover(struct tape *t, struct bencode *ctx, const struct doc *d)
+{
+    int r;
+    bencode_reinit(ctx, d->buf, d->len);
+    do {
+        r = bencode_next(ctx);
+        record_result(t, ctx, d->buf, r);
+        if (r == BENCODE_ERROR_INVALID || r == BENCODE_ERROR_BAD_KEY)
+            if (bencode_recover(ctx, r) == BENCODE_DONE)
+                r = BENCODE_INTEGER; /* any token type, to keep going */
+    } while (r > 0);
+}
+
+/* How a mode's tape must relate to the reference tape */
+#define MATCH_EXACT     0  /* identical */
+#define MATCH_UNSORTED  1  /* identical until the first BAD_KEY */
+#define MATCH_PREFIX    2  /* identical through the first error */
+
+/* Recovery over pathological input may take this many times longer per
+ * byte than plain parsing of the corpus, i.e. it must stay linear. */
+#define RECOVER_BOUND 20.0
+
+static const struct engine {
+    const char *name;
+    void (*run)(struct tape *, struct bencode *, const struct doc *);
+    int match;
+} engines[] = {
+    {"reference",   engine_reference,   MATCH_EXACT},
+    {"incremental", engine_incremental, MATCH_EXACT},
+    {"keys",        engine_keys,        MATCH_EXACT},
+    {"unsorted",    engine_unsorted,    MATCH_UNSORTED},
+    {"recover",     engine_recover,     MATCH_PREFIX}
+};
+
+/* Return the index of the first mismatching token, or -1. */
+static long
+compare(const struct tape *ref, const struct tape *t, int match)
+{
+    size_t i;
+    for (i = 0; i < ref->len; i++) {
+        const struct token *a = ref->tokens + i;
+        const struct token *b = t->tokens + i;
+        if (match == MATCH_UNSORTED && a->type == BENCODE_ERROR_BAD_KEY)
+            return -1;
+        if (i == t->len)
+            return i;
+        if (a->type != b->type || a->off != b->off || a->len != b->len)
+            return i;
+        if (match == MATCH_PREFIX && a->type < 0)
+            return -1;
+    }
+    return i == t->len ? -1 : (long)i;
+}
+
+/* Calibration pass: a serial hash of every corpus byte, no parsing */
+static unsigned long
+calibrate(const struct doc *corpus, size_t count)
+{
+    size_t i, j;
+    unsigned long h = 0;
+    for (j = 0; j < count; j++)
+        for (i = 0; i < corpus[j].len; i++)
+            h = (h * 31 + (unsigned char)corpus[j].buf[i]) & 0xffffffffUL;
+    return h;
+}
+
+static int
+cmpdouble(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double
+lookup(const char *path, const char *name)
+{
+    char line[256], key[128];
+    double ratio, found = -1;
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return -1;
+    while (fgets(line, sizeof(line), f))
+        if (sscanf(line, "%127s %lf", key, &ratio) == 2 && !strcmp(key, name))
+            found = ratio;
+    fclose(f);
+    return found;
+}
+
+int
+main(int argc, char **argv)
+{
+    int i, k;
+    size_t j;
+    int fail = 0;
+    int write = 0;
+    unsigned long seed = 0x2545f491UL;
+    size_t count = 2000;
+    int rounds = 21;
+    double threshold = 1.5;
+    const char *baseline = 0;
+    struct doc *corpus;
+    struct doc slow[PATHOLOGICAL];
+    size_t slowtotal = 0;
+    struct tape ref = {0, 0, 0};
+    struct tape got = {0, 0, 0};
+    struct bencode ctx[1];
+    size_t total = 0, nvalid = 0;
+    double times[countof(engines) + 2];
+    volatile unsigned long sink = 0;
+    double *samples;
+    FILE *out = 0;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            seed = strtoul(argv[++i], 0, 0);
+        } else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            count = strtoul(argv[++i], 0, 0);
+        } else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            rounds = atoi(argv[++i]);
+            rounds = rounds > 0 ? rounds : 1;
+        } else if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-w")) {
+            write = 1;
+        } else if (argv[i][0] != 0x2d) {
+            baseline = argv[i];
+        } else {
+            fprintf(stderr, "usage: harness [-s seed] [-n count] "
+                            "[-r rounds] [-t threshold] [-w] "
+                            "[baseline]\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* Build the corpus, every other document damaged */
+    rng_state = seed ? seed & 0xffffffffUL : 1;
+    corpus = xrealloc(0, count * sizeof(*corpus));
+    for (j = 0; j < count; j++) {
+        size_t cap = 0;
+        corpus[j].buf = 0;
+        corpus[j].len = 0;
+        corpus[j].damaged = j % 2;
+        gen_value(corpus + j, &cap, 1 + rng() % 6);
+        if (corpus[j].damaged)
+            mutate(corpus + j, &cap);
+        else
+            nvalid++;
+        total += corpus[j].len;
+    }
+    for (i = 0; i < PATHOLOGICAL; i++) {
+        size_t cap = 0;
+        slow[i].buf = 0;
+        slow[i].len = 0;
+        gen_pathological(slow + i, &cap, i);
+        slowtotal += slow[i].len;
+    }
+    printf("corpus: seed %#lx, %lu documents (%lu valid), %lu bytes\n",
+           seed, (unsigned long)count, (unsigned long)nvalid,
+           (unsigned long)total);
+
+    /* Undamaged documents must parse cleanly to the end */
+    bencode_init(ctx, 0, 0);
+    for (j = 0; j < count; j++) {
+        if (corpus[j].damaged)
+            continue;
+        ref.len = 0;
+        engine_reference(&ref, ctx, corpus + j);
+        if (ref.tokens[ref.len - 1].type != BENCODE_DONE) {
+            printf(C_RED("FAIL") " reference: valid document %lu\n",
+                   (unsigned long)j);
+            fail = 1;
+            break;
+        }
+    }
+
+    /* Differential check against the reference token stream */
+    verify = 1;
+    for (i = 1; i < (int)countof(engines); i++) {
+        size_t mismatches = 0;
+        for (j = 0; j < count + PATHOLOGICAL; j++) {
+            long at;
+            const struct doc *d = j < count ? corpus + j : slow + j - count;
+            int match = d->damaged ? engines[i].match : MATCH_EXACT;
+            ref.len = got.len = 0;
+            engine_reference(&ref, ctx, d);
+            engines[i].run(&got, ctx, d);
+            at = compare(&ref, &got, match);
+            if (at >= 0 && !mismatches++)
+                printf(C_RED("FAIL") " %s: document %lu, token %ld\n",
+                       engines[i].name, (unsigned long)j, at);
+        }
+        if (mismatches)
+            fail = 1;
+        else
+            printf(C_GREEN("PASS") " %s matches reference\n",
+                   engines[i].name);
+    }
+
+    verify = 0;
+
+    /* Throughput, median of interleaved rounds to reduce noise */
+    samples = xrealloc(0, (countof(engines) + 2) * rounds * sizeof(*samples));
+    for (k = 0; k < rounds; k++) {
+        clock_t start;
+        for (i = 0; i < (int)countof(engines); i++) {
+            clock_t start = clock();
+            for (j = 0; j < count; j++) {
+                got.len = 0;
+                engines[i].run(&got, ctx, corpus + j);
+            }
+            samples[i * rounds + k] =
+                (double)(clock() - start) / CLOCKS_PER_SEC;
+        }
+        start = clock();
+        for (j = 0; j < PATHOLOGICAL; j++) {
+            got.len = 0;
+            engine_recover(&got, ctx, slow + j);
+        }
+        samples[countof(engines) * rounds + k] =
+            (double)(clock() - start) / CLOCKS_PER_SEC;
+        start = clock();
+        sink += calibrate(corpus, count);
+        samples[(countof(engines) + 1) * rounds + k] =
+            (double)(clock() - start) / CLOCKS_PER_SEC;
+    }
+    for (i = 0; i < (int)countof(times); i++) {
+        qsort(samples + i * rounds, rounds, sizeof(*samples), cmpdouble);
+        times[i] = samples[i * rounds + rounds / 2];
+    }
+    free(samples);
+
+    if (write && baseline) {
+        out = fopen(baseline, "w");
+        if (!out) {
+            fprintf(stderr, "harness: cannot write %s\n", baseline);
+            return EXIT_FAILURE;
+        }
+    }
+    for (i = 0; i < (int)countof(engines); i++) {
+        double ratio = times[0] > 0 ? times[i] / times[0] : 1;
+        double mbs = times[i] > 0 ? total / times[i] / 1e6 : 0;
+        double base = baseline && !write ? lookup(baseline, engines[i].name)
+                                         : -1;
+        int regressed = base > 0 && ratio > base * threshold;
+        printf("%s %-12s %8.1f MB/s  ratio %5.2f",
+               regressed ? C_RED("SLOW") : "    ",
+               engines[i].name, mbs, ratio);
+        if (base > 0)
+            printf("  baseline %5.2f", base);
+        putchar(0x0a);
+        if (regressed)
+            fail = 1;
+        if (out)
+            fprintf(out, "%s %.2f\n", engines[i].name, ratio);
+    }
+
+    /* Reference time in calibration units, so it can regress too */
+    {
+        double unit = times[countof(engines) + 1];
+        double ratio = unit > 0 ? times[0] / unit : 0;
+        double base = baseline && !write ? lookup(baseline, "calibrated")
+                                         : -1;
+        int regressed = base > 0 && ratio > base * threshold;
+        printf("%s %-12s %8.1f MB/s  ratio %5.2f",
+               regressed ? C_RED("SLOW") : "    ", "calibrated",
+               unit > 0 ? total / unit / 1e6 : 0, ratio);
+        if (base > 0)
+            printf("  baseline %5.2f", base);
+        putchar(0x0a);
+        if (regressed)
+            fail = 1;
+        if (out)
+            fprintf(out, "%s %.2f\n", "calibrated", ratio);
+    }
+    if (out)
+        fclose(out);
+
+    /* Recovery time per damaged byte against parse time per byte */
+    {
+        double unit = times[0] / total;
+        double cost = times[countof(engines)] / slowtotal;
+        int slower = unit > 0 && cost > unit * RECOVER_BOUND;
+        printf("%s %-12s %8.1f MB/s  cost  %5.2f  limit %5.2f\n",
+               slower ? C_RED("SLOW") : "    ", "pathological",
+               cost > 0 ? 1e-6 / cost : 0,
+               unit > 0 ? cost / unit : 0, RECOVER_BOUND);
+        if (slower)
+            fail = 1;
+    }
+
+    for (j = 0; j < count; j++)
+        free(corpus[j].buf);
+    free(corpus);
+    for (i = 0; i < PATHOLOGICAL; i++)
+        free(slow[i].buf);
+    free(ref.tokens);
+    free(got.tokens);
+    bencode_free(ctx);
+    return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
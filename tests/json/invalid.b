@@ -0,0 +1 @@
+d5:helloli1e3:abcd1:ai1e1:ai2eee
\ No newline at end of file
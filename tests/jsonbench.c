@@ -0,0 +1,150 @@
+/* bencode2json and json2bencode throughput benchmark
+ *
+ * Times each bencode2json output mode over an input file, reading the
+ * file and discarding the JSON just as the program does with
+ * redirection, then times json2bencode over that mode's JSON and checks
+ * that it reproduces the input exactly. Reports the median of several
+ * rounds in MB/s of bencode.
+ *
+ * Usage: jsonbench [-r rounds] INPUT
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../json.h"
+
+static int
+cmpdouble(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Return 1 if two streams hold the same bytes. */
+static int
+same(FILE *a, FILE *b)
+{
+    int c;
+    rewind(a);
+    rewind(b);
+    do
+        if ((c = getc(a)) != getc(b))
+            return 0;
+    while (c != EOF);
+    return 1;
+}
+
+/* Median time of running a conversion from in to out over the rounds */
+static double
+measure(int (*run)(FILE *, FILE *, int), FILE *in, FILE *out, int mode,
+        double *samples, int rounds)
+{
+    int k;
+    for (k = 0; k < rounds; k++) {
+        clock_t start;
+        rewind(in);
+        start = clock();
+        if (run(in, out, mode))
+            return -1;
+        samples[k] = (double)(clock() - start) / CLOCKS_PER_SEC;
+    }
+    qsort(samples, rounds, sizeof(*samples), cmpdouble);
+    return samples[rounds / 2];
+}
+
+static int
+decode(FILE *in, FILE *out, int mode)
+{
+    (void)mode;
+    return json2bencode(in, out);
+}
+
+int
+main(int argc, char **argv)
+{
+    static const char *const names[] = {"-e", "-x", "-b"};
+    static const int modes[] = {JSON_ESCAPE, JSON_HEX, JSON_BASE64};
+    FILE *in, *out;
+    int i;
+    int rounds = 9;
+    const char *path = 0;
+    double *samples;
+    long size;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            rounds = atoi(argv[++i]);
+            rounds = rounds > 0 ? rounds : 1;
+        } else if (argv[i][0] != 0x2d && !path) {
+            path = argv[i];
+        } else {
+            fprintf(stderr, "usage: jsonbench [-r rounds] INPUT\n");
+            return EXIT_FAILURE;
+        }
+    }
+    if (!path) {
+        fprintf(stderr, "usage: jsonbench [-r rounds] INPUT\n");
+        return EXIT_FAILURE;
+    }
+
+    out = fopen("/dev/null", "wb");
+    in = fopen(path, "rb");
+    if (!out || !in || fseek(in, 0, SEEK_END)) {
+        fprintf(stderr, "jsonbench: cannot open %s\n", path);
+        return EXIT_FAILURE;
+    }
+    size = ftell(in);
+
+    samples = malloc(rounds * sizeof(*samples));
+    if (!samples) {
+        fprintf(stderr, "jsonbench: out of memory\n");
+        return EXIT_FAILURE;
+    }
+    printf("input: %s, %ld bytes\n", path, size);
+    for (i = 0; i < (int)(sizeof(modes) / sizeof(*modes)); i++) {
+        double t;
+        int ok;
+        FILE *json = tmpfile();
+        FILE *back = tmpfile();
+        if (!json || !back) {
+            fprintf(stderr, "jsonbench: cannot create temporary file\n");
+            return EXIT_FAILURE;
+        }
+
+        t = measure(bencode2json, in, out, modes[i], samples, rounds);
+        if (t < 0) {
+            fprintf(stderr, "jsonbench: bencode2json %s failed\n", names[i]);
+            return EXIT_FAILURE;
+        }
+        printf("bencode2json %s  %8.1f MB/s\n",
+               names[i], t > 0 ? size / t / 1e6 : 0);
+
+        /* Keep this mode's JSON and check that it converts back */
+        rewind(in);
+        ok = !bencode2json(in, json, modes[i]);
+        if (ok) {
+            rewind(json);
+            ok = !json2bencode(json, back) && same(in, back);
+        }
+        if (!ok) {
+            fprintf(stderr, "jsonbench: %s does not round-trip\n", names[i]);
+            return EXIT_FAILURE;
+        }
+        t = measure(decode, json, out, 0, samples, rounds);
+        if (t < 0) {
+            fprintf(stderr, "jsonbench: json2bencode %s failed\n", names[i]);
+            return EXIT_FAILURE;
+        }
+        printf("json2bencode %s  %8.1f MB/s\n",
+               names[i], t > 0 ? size / t / 1e6 : 0);
+        fclose(json);
+        fclose(back);
+    }
+
+    free(samples);
+    fclose(in);
+    fclose(out);
+    return EXIT_SUCCESS;
+}
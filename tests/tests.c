@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 #include "../bencode.h"
@@ -20,19 +21,42 @@ struct expect {
 
 #define countof(a) (sizeof(a) / sizeof(*a))
 
-#define TEST(name) \
+/* Tally a test function's result */
+#define COUNT(r) \
     do { \
-        int r = test(name, seq, countof(seq), str, sizeof(str) - 1); \
         if (r) \
             count_pass++; \
         else \
             count_fail++; \
     } while (0)
 
+#define TEST_OPTIONS(name, options) \
+    COUNT(test(name, seq, countof(seq), str, sizeof(str) - 1, options))
+
+#define TEST(name) TEST_OPTIONS(name, 0)
+
+#define TEST_LOCATE(name, expect_r, expect_str) \
+    COUNT(test_locate(name, str, sizeof(str) - 1, path, \
+                      expect_r, expect_str))
+
+#define TEST_KEYS(name, options) \
+    COUNT(test_keys(name, str, sizeof(str) - 1, keys, countof(keys), \
+                    ids, countof(ids), options))
+
+#define TEST_RESUME(name) \
+    COUNT(test_resume(name, str, sizeof(str) - 1))
+
+#define TEST_RECOVER(name, expect) \
+    COUNT(test_recover(name, str, sizeof(str) - 1, expect))
+
+#define TEST_CANONICAL(name, expect_r, expect_str) \
+    COUNT(test_canonical(name, str, sizeof(str) - 1, expect_r, expect_str))
+
 const char *
 typename(int t)
 {
     static const char *const table[] = {
+        "ERROR_NOT_FOUND",
         "ERROR_OOM",
         "ERROR_BAD_KEY",
         "ERROR_EOF",
@@ -45,13 +69,31 @@ typename(int t)
         "DICT_BEGIN",
         "DICT_END"
     };
-    return table[t + 4];
+    return table[t + 5];
+}
+
+/* Print a test's result, with details formatted on failure. */
+static int
+report(const char *name, int success, const char *fmt, ...)
+{
+    if (success) {
+        printf(C_GREEN("PASS") " %s\n", name);
+    } else {
+        va_list ap;
+        printf(C_RED("FAIL") " %s: ", name);
+        va_start(ap, fmt);
+        vprintf(fmt, ap);
+        va_end(ap);
+        putchar(0x0a);
+    }
+    return success;
 }
 
 static int
 has_value(int type)
 {
-    return type == BENCODE_INTEGER || type == BENCODE_STRING;
+    return type == BENCODE_INTEGER || type == BENCODE_STRING ||
+           type == BENCODE_LIST_END || type == BENCODE_DICT_END;
 }
 
 static int
@@ -59,7 +101,8 @@ test(const char *name,
      struct expect *seq,
      size_t seqlen,
      const char *buf,
-     size_t len)
+     size_t len,
+     int options)
 {
     size_t i;
     int success = 1;
@@ -69,6 +112,7 @@ test(const char *name,
     const char *expect_str, *actual_str;
 
     bencode_init(ctx, buf, len);
+    ctx->options = options;
     for (i = 0; success && i < seqlen; i++) {
         expect = seq[i].type;
         actual = bencode_next(ctx);
@@ -87,16 +131,213 @@ test(const char *name,
         }
     }
 
-    if (success) {
-        printf(C_GREEN("PASS") " %s\n", name);
-    } else {
-        printf(C_RED("FAIL") " %s: "
-               "expect " C_BOLD("%s") " %s / "
-               "actual " C_BOLD("%s") " %.*s\n",
-               name,
-               typename(expect), expect_str,
-               typename(actual), (int)actual_len, actual_str);
+    report(name, success,
+           "expect " C_BOLD("%s") " %s / "
+           "actual " C_BOLD("%s") " %.*s",
+           typename(expect), expect_str,
+           typename(actual), (int)actual_len, actual_str);
+    bencode_free(ctx);
+    return success;
+}
+
+static int
+test_canonical(const char *name,
+               const char *buf,
+               size_t len,
+               int expect,
+               const char *expect_str)
+{
+    int success = 1;
+    struct bencode ctx[1];
+    char *out = malloc(len + 1);
+    int actual;
+
+    bencode_init(ctx, buf, len);
+    actual = bencode_canonicalize(ctx, out);
+    if (actual != expect)
+        success = 0;
+    else if (actual == BENCODE_DONE && memcmp(out, expect_str, len))
+        success = 0;
+    else if (actual == BENCODE_ERROR_BAD_KEY &&
+             (ctx->toklen != strlen(expect_str) ||
+              memcmp(ctx->tok, expect_str, ctx->toklen)))
+        success = 0;
+
+    report(name, success,
+           "expect " C_BOLD("%s") " %s / "
+           "actual " C_BOLD("%s") " %.*s",
+           typename(expect), expect_str,
+           typename(actual), (int)len, out);
+    free(out);
+    bencode_free(ctx);
+    return success;
+}
+
+/* Offset of p into buf, or -1 for a null pointer. */
+static long
+offset(const void *p, const char *buf)
+{
+    return p ? (long)((const char *)p - buf) : -1;
+}
+
+/* Compare a whole-buffer parse to one fed a byte at a time into a
+ * buffer that moves on every feed, as with realloc(). */
+static int
+test_resume(const char *name, const char *buf, size_t len)
+{
+    int success = 1;
+    struct bencode whole[1];
+    struct bencode part[1];
+    int expect, actual;
+    char *copy = malloc(1);
+    size_t fed = 0;
+    long n = 0;
+
+    bencode_init(whole, buf, len);
+    bencode_init(part, copy, 0);
+    do {
+        expect = bencode_next(whole);
+        while ((actual = bencode_next(part)) == BENCODE_ERROR_EOF &&
+               fed < len) {
+            char *grown = malloc(fed + 1);
+            memcpy(grown, copy, fed);
+            grown[fed] = buf[fed];
+            memset(copy, 0x78, fed); /* x, catch stale pointers */
+            free(copy);
+            copy = grown;
+            bencode_rebase(part, copy);
+            bencode_extend(part, 1);
+            fed++;
+        }
+        if (actual != expect ||
+            offset(whole->tok, buf) != offset(part->tok, copy) ||
+            (has_value(actual) && whole->toklen != part->toklen) ||
+            (actual < 0 && offset(whole->buf, buf) != offset(part->buf, copy)))
+            success = 0;
+        n++;
+    } while (success && expect > 0);
+
+    report(name, success,
+           "token %ld, expect " C_BOLD("%s") " / actual " C_BOLD("%s"),
+           n, typename(expect), typename(actual));
+    free(copy);
+    bencode_free(whole);
+    bencode_free(part);
+    return success;
+}
+
+/* Parse with error recovery, summarizing the tokens as a string. */
+static int
+test_recover(const char *name, const char *buf, size_t len, const char *expect)
+{
+    int r;
+    int success;
+    char trace[256];
+    size_t n = 0;
+    struct bencode ctx[1];
+
+    bencode_init(ctx, buf, len);
+    for (;;) {
+        r = bencode_next(ctx);
+        if (r == BENCODE_ERROR_INVALID || r == BENCODE_ERROR_BAD_KEY) {
+            /* Mark the error with its offset */
+            n += sprintf(trace + n, "!%lu",
+                         (unsigned long)((char *)ctx->buf - buf));
+            r = bencode_recover(ctx, r);
+            if (r < 0)
+                break;
+        } else if (r > 0) {
+            static const char marks[] = "is[]{}";
+            trace[n++] = marks[r - 1];
+            if (r == BENCODE_INTEGER || r == BENCODE_STRING) {
+                memcpy(trace + n, ctx->tok, ctx->toklen);
+                n += ctx->toklen;
+            }
+        } else {
+            break;
+        }
+        trace[n++] = 0x20;
     }
+    while (n && trace[n - 1] == 0x20)
+        n--;
+    if (r == BENCODE_ERROR_EOF)
+        trace[n++] = 0x24; /* $ */
+    trace[n] = 0;
+
+    success = !strcmp(trace, expect);
+    report(name, success,
+           "expect " C_BOLD("%s") " / actual " C_BOLD("%s"), expect, trace);
+    bencode_free(ctx);
+    return success;
+}
+
+static int
+test_keys(const char *name,
+          const char *buf,
+          size_t len,
+          const char *const *keys,
+          size_t nkeys,
+          const int *ids,
+          size_t nids,
+          int options)
+{
+    int success = 1;
+    struct bencode ctx[1];
+    size_t i = 0;
+    int r;
+
+    bencode_init(ctx, buf, len);
+    ctx->options = options;
+    success = !bencode_keys(ctx, keys, nkeys);
+    while (success && (r = bencode_next(ctx)) > 0) {
+        if (r == BENCODE_STRING && BENCODE_IS_VALUE(ctx)) {
+            if (i == nids || ctx->keyid != ids[i])
+                success = 0;
+            i++;
+        } else if (ctx->keyid != -1) {
+            success = 0;
+        }
+    }
+    if (r != BENCODE_DONE || i != nids)
+        success = 0;
+
+    report(name, success,
+           "key %lu, expect " C_BOLD("%d") " / actual " C_BOLD("%d"),
+           (unsigned long)i - 1, i <= nids && i ? ids[i - 1] : -1,
+           ctx->keyid);
+    bencode_free(ctx);
+    return success;
+}
+
+static int
+test_locate(const char *name,
+            const char *buf,
+            size_t len,
+            const char *const *path,
+            int expect,
+            const char *expect_str)
+{
+    int success = 1;
+    struct bencode ctx[1];
+    size_t off = 0;
+    size_t span = 0;
+    int actual;
+
+    bencode_init(ctx, buf, len);
+    actual = bencode_locate(ctx, path, &off, &span);
+    if (actual != expect)
+        success = 0;
+    else if (actual > 0 && (off > len || span != strlen(expect_str) ||
+                            memcmp(buf + off, expect_str, span)))
+        success = 0;
+    else if (actual == BENCODE_DONE && strcmp(buf + off, expect_str))
+        success = 0;
+
+    report(name, success,
+           "expect " C_BOLD("%s") " %s / "
+           "actual " C_BOLD("%s") " %.*s",
+           typename(expect), expect_str,
+           typename(actual), (int)span, buf + off);
     bencode_free(ctx);
     return success;
 }
@@ -126,6 +367,16 @@ main(void)
         TEST("trailing garbage");
     }
 
+    {
+        const char str[] = "lei0e";
+        struct expect seq[] = {
+            {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_END, "le"},
+            {BENCODE_ERROR_INVALID}
+        };
+        TEST("trailing value");
+    }
+
     {
         const char str[] = " i0e";
         struct expect seq[] = {
@@ -274,7 +525,7 @@ main(void)
     {
         const char str[] = "1000000000000000000000000000000000000000:x";
         struct expect seq[] = {
-            {BENCODE_ERROR_EOF}
+            {BENCODE_ERROR_INVALID}
         };
         TEST("ridiculous string");
     }
@@ -293,7 +544,8 @@ main(void)
         const char str[] = "le";
         struct expect seq[] = {
             {BENCODE_LIST_BEGIN},
-            {BENCODE_LIST_END}
+            {BENCODE_LIST_END, "le"},
+            {BENCODE_DONE}
         };
         TEST("empty list");
     }
@@ -334,6 +586,22 @@ main(void)
         TEST("nested list");
     }
 
+    {
+        const char str[] = "li1el5:helloleee";
+        struct expect seq[] = {
+            {BENCODE_LIST_BEGIN},
+            {BENCODE_INTEGER, "1"},
+            {BENCODE_LIST_BEGIN},
+            {BENCODE_STRING, "hello"},
+            {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_END, "le"},
+            {BENCODE_LIST_END, "l5:hellolee"},
+            {BENCODE_LIST_END, "li1el5:helloleee"},
+            {BENCODE_DONE}
+        };
+        TEST("list spans");
+    }
+
     {
         const char str[] = "l";
         struct expect seq[] = {
@@ -343,6 +611,49 @@ main(void)
         TEST("truncated list");
     }
 
+    {
+        const char str[] = "llllllllllllllllllllllllllllllllllllllllllllllll"
+                           "llllllllllllllllllllllllllllllllllllllllllllllll"
+                           "eeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeee"
+                           "eeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeee";
+        struct expect seq[] = {
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN}, {BENCODE_LIST_BEGIN},
+            {BENCODE_LIST_END, "le"}
+        };
+        TEST("deep nesting");
+    }
+
     {
         const char str[] = "li0e";
         struct expect seq[] = {
@@ -369,7 +680,8 @@ main(void)
         const char str[] = "de";
         struct expect seq[] = {
             {BENCODE_DICT_BEGIN},
-            {BENCODE_DICT_END}
+            {BENCODE_DICT_END, "de"},
+            {BENCODE_DONE}
         };
         TEST("empty dictionary");
     }
@@ -414,6 +726,26 @@ main(void)
         TEST("nested dictionary");
     }
 
+    {
+        const char str[] = "d8:announce3:url4:infod6:lengthi1e4:name1:xee";
+        struct expect seq[] = {
+            {BENCODE_DICT_BEGIN},
+            {BENCODE_STRING, "announce"},
+            {BENCODE_STRING, "url"},
+            {BENCODE_STRING, "info"},
+            {BENCODE_DICT_BEGIN},
+            {BENCODE_STRING, "length"},
+            {BENCODE_INTEGER, "1"},
+            {BENCODE_STRING, "name"},
+            {BENCODE_STRING, "x"},
+            {BENCODE_DICT_END, "d6:lengthi1e4:name1:xe"},
+            {BENCODE_DICT_END, "d8:announce3:url4:info"
+                               "d6:lengthi1e4:name1:xee"},
+            {BENCODE_DONE}
+        };
+        TEST("info dictionary span");
+    }
+
     {
         const char str[] = "dee";
         struct expect seq[] = {
@@ -491,6 +823,270 @@ main(void)
         TEST("missing value 2");
     }
 
+    {
+        const char str[] = "d1:bi0e1:ai0ee";
+        struct expect seq[] = {
+            {BENCODE_DICT_BEGIN},
+            {BENCODE_STRING, "b"},
+            {BENCODE_INTEGER, "0"},
+            {BENCODE_STRING, "a"},
+            {BENCODE_INTEGER, "0"},
+            {BENCODE_DICT_END, "d1:bi0e1:ai0ee"},
+            {BENCODE_DONE}
+        };
+        TEST_OPTIONS("unsorted option", BENCODE_OPTION_UNSORTED);
+    }
+
+    /* Incremental input tests */
+
+    {
+        const char str[] = "d8:announce3:url4:infod6:lengthi-12e4:name1:xee";
+        TEST_RESUME("resume dictionary");
+    }
+
+    {
+        const char str[] = "li0el10:0123456789lee0:de";
+        TEST_RESUME("resume list");
+    }
+
+    {
+        const char str[] = "d1:bi0e1:ai0ee";
+        TEST_RESUME("resume bad key");
+    }
+
+    {
+        const char str[] = "li01ee";
+        TEST_RESUME("resume invalid");
+    }
+
+    {
+        const char str[] = "d1:a";
+        TEST_RESUME("resume truncated");
+    }
+
+    {
+        const char str[] = "l99999999999999999999999";
+        struct expect seq[] = {
+            {BENCODE_LIST_BEGIN},
+            {BENCODE_ERROR_INVALID}
+        };
+        TEST("oversized length is not truncation");
+        TEST_RESUME("resume oversized length");
+    }
+
+    /* Error recovery tests */
+
+    {
+        const char str[] = "li01ei2ee";
+        TEST_RECOVER("recover integer", "[ !3 i2 ]");
+    }
+
+    {
+        const char str[] = "d1:ai01e1:bi2ee";
+        TEST_RECOVER("recover dictionary value", "{ sa !6 sb i2 }");
+    }
+
+    {
+        const char str[] = "d1:bi0e1:ali1ee1:ci2ee";
+        TEST_RECOVER("recover bad key", "{ sb i0 !10 sc i2 }");
+    }
+
+    {
+        const char str[] = "d1:ai0e1:bi1ee1:ci2ee";
+        TEST_RECOVER("recover dangling key", "{ sa i0 sb i1 } !14");
+    }
+
+    {
+        const char str[] = "di1ei1ee";
+        TEST_RECOVER("recover integer key", "{ !1 }");
+    }
+
+    {
+        const char str[] = "l5:hellox3:abc?le3:xyze";
+        TEST_RECOVER("recover list garbage",
+                     "[ shello !8 sabc !14 [ ] sxyz ]");
+    }
+
+    {
+        const char str[] = "l3:a:b2:e:e";
+        TEST_RECOVER("recover string skip", "[ sa:b se: ]");
+    }
+
+    {
+        const char str[] = " i0e";
+        TEST_RECOVER("recover leading garbage", "!0 i0");
+    }
+
+    {
+        const char str[] = "i0e junk";
+        TEST_RECOVER("recover trailing garbage", "i0 !3");
+    }
+
+    {
+        const char str[] = "l1:ax";
+        TEST_RECOVER("recover to end", "[ sa !4$");
+    }
+
+    {
+        const char str[] = "d1x1:ai1ee";
+        TEST_RECOVER("recover malformed key", "{ !2 sa i1 }");
+    }
+
+    {
+        const char str[] = "d1:ai1e2x1:bi2ee";
+        TEST_RECOVER("recover malformed later key", "{ sa i1 !8 sb i2 }");
+    }
+
+    {
+        const char str[] = "l99999999999999999999999:i1ee";
+        TEST_RECOVER("recover oversized length", "[ !1 i1 ]");
+    }
+
+    {
+        /* Scanning a long digit run must not be quadratic */
+        size_t i, len = (size_t)1 << 22;
+        char *buf = malloc(len + 4);
+        memcpy(buf, "lx", 2);
+        for (i = 0; i < len; i++)
+            buf[i + 2] = 0x31; /* 1 */
+        memcpy(buf + len + 2, "xe", 2);
+        if (test_recover("recover long digit run", buf, len + 4, "[ !1 ]"))
+            count_pass++;
+        else
+            count_fail++;
+        buf[len + 2] = 0x3a; /* : */
+        if (test_recover("recover long length prefix", buf, len + 4,
+                         "[ !1 se$"))
+            count_pass++;
+        else
+            count_fail++;
+        free(buf);
+    }
+
+    /* Key set tests */
+
+    {
+        const char str[] = "d1:ad2:id1:x1:qi0ee1:t2:aa1:y1:qe";
+        const char *keys[] = {"a", "id", "info_hash", "q", "t", "y"};
+        int ids[] = {0, 1, 3, 4, 5};
+        TEST_KEYS("key set", 0);
+    }
+
+    {
+        const char str[] = "d1:b0:2:bb0:2:bc0:1:c0:e";
+        const char *keys[] = {"a", "bb", "c"};
+        int ids[] = {-1, 1, -1, 2};
+        TEST_KEYS("key set prefixes", 0);
+    }
+
+    {
+        const char str[] = "d0:0:1:a0:2:ab0:3:abc0:2:ac0:e";
+        const char *keys[] = {"", "ab", "abc", "ac", "b"};
+        int ids[] = {0, -1, 1, 2, 3};
+        TEST_KEYS("key set shared first byte", 0);
+    }
+
+    {
+        const char str[] = "d1:y0:1:a0:1:q0:e";
+        const char *keys[] = {"a", "q", "y"};
+        int ids[] = {2, 0, 1};
+        TEST_KEYS("key set unsorted", BENCODE_OPTION_UNSORTED);
+    }
+
+    /* Canonicalization tests */
+
+    {
+        const char str[] = "d1:ad1:xi1e1:yi2ee1:bli3eee";
+        TEST_CANONICAL("canonical passthrough", BENCODE_DONE,
+                       "d1:ad1:xi1e1:yi2ee1:bli3eee");
+    }
+
+    {
+        const char str[] = "d1:bi0e2:aa1:x1:ai0ee";
+        TEST_CANONICAL("canonicalize unsorted", BENCODE_DONE,
+                       "d1:ai0e2:aa1:x1:bi0ee");
+    }
+
+    {
+        const char str[] = "d1:zd1:yi1e1:xi2ee1:ald1:q0:1:p0:eee";
+        TEST_CANONICAL("canonicalize nested", BENCODE_DONE,
+                       "d1:ald1:p0:1:q0:ee1:zd1:xi2e1:yi1eee");
+    }
+
+    {
+        const char str[] = "ld1:bi0e1:ai0eed1:ai0eee";
+        TEST_CANONICAL("canonicalize in list", BENCODE_DONE,
+                       "ld1:ai0e1:bi0eed1:ai0eee");
+    }
+
+    {
+        const char str[] = "d1:bi0e1:ai0e1:bi1ee";
+        TEST_CANONICAL("canonicalize duplicate", BENCODE_ERROR_BAD_KEY, "b");
+    }
+
+    {
+        const char str[] = "d1:bi0e1:a";
+        TEST_CANONICAL("canonicalize truncated", BENCODE_ERROR_EOF, "");
+    }
+
+    /* Locate tests */
+
+    {
+        const char str[] = "d8:announce3:url4:infod6:lengthi1e4:name1:xee";
+        const char *path[] = {"announce", 0};
+        TEST_LOCATE("locate string", BENCODE_STRING, "3:url");
+    }
+
+    {
+        const char str[] = "d8:announce3:url4:infod6:lengthi1e4:name1:xee";
+        const char *path[] = {"info", "length", 0};
+        TEST_LOCATE("locate nested integer", BENCODE_INTEGER, "i1e");
+    }
+
+    {
+        const char str[] = "d8:announce3:url4:infod6:lengthi1e4:name1:xee";
+        const char *path[] = {"info", 0};
+        TEST_LOCATE("locate dictionary", BENCODE_DICT_BEGIN,
+                    "d6:lengthi1e4:name1:xe");
+    }
+
+    {
+        const char str[] = "d8:announce3:url4:infod6:lengthi1e4:name1:xee";
+        const char *path[] = {0};
+        TEST_LOCATE("locate root", BENCODE_DICT_BEGIN, str);
+    }
+
+    {
+        const char str[] = "d8:announce3:url4:infod6:lengthi1e4:name1:xee";
+        const char *path[] = {"comment", 0};
+        TEST_LOCATE("locate insert middle", BENCODE_DONE,
+                    "4:infod6:lengthi1e4:name1:xee");
+    }
+
+    {
+        const char str[] = "d8:announce3:url4:infod6:lengthi1e4:name1:xee";
+        const char *path[] = {"info", "private", 0};
+        TEST_LOCATE("locate insert end", BENCODE_DONE, "ee");
+    }
+
+    {
+        const char str[] = "d8:announce3:url4:infod6:lengthi1e4:name1:xee";
+        const char *path[] = {"announce", "x", 0};
+        TEST_LOCATE("locate not dictionary", BENCODE_ERROR_NOT_FOUND, "");
+    }
+
+    {
+        const char str[] = "d8:announce3:url4:infod6:lengthi1e4:name1:xee";
+        const char *path[] = {"foo", "bar", 0};
+        TEST_LOCATE("locate missing parent", BENCODE_ERROR_NOT_FOUND, "");
+    }
+
+    {
+        const char str[] = "d8:announce3:url4:infoi0ee ";
+        const char *path[] = {"announce", 0};
+        TEST_LOCATE("locate validates", BENCODE_ERROR_INVALID, "");
+    }
+
     printf("%d pass, %d fail\n", count_pass, count_fail);
     return count_fail ? EXIT_FAILURE : EXIT_SUCCESS;
 }
@@ -0,0 +1,132 @@
+/* Torrent-shaped bencode generator for benchmarks
+ *
+ * Writes a deterministic multi-file torrent to standard output: tracker
+ * lists, a file list with nested paths, mostly UTF-8 names with some
+ * Latin-1 ones as old clients produced, and a binary pieces string of
+ * SHA-1 sized hashes. The size scales with the file count.
+ *
+ * Usage: torrentgen [files] >OUTPUT
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PIECE_LENGTH (256UL * 1024)
+
+static unsigned long rng_state = 0x2545f491UL;
+
+/* Same portable xorshift as the harness. */
+static unsigned long
+rng(void)
+{
+    unsigned long x = rng_state;
+    x ^= x << 13 & 0xffffffffUL;
+    x ^= x >> 17;
+    x ^= x << 5 & 0xffffffffUL;
+    rng_state = x & 0xffffffffUL;
+    return rng_state;
+}
+
+static void
+string(const char *s, size_t len)
+{
+    printf("%lu:", (unsigned long)len);
+    fwrite(s, len, 1, stdout);
+}
+
+static void
+key(const char *s)
+{
+    string(s, strlen(s));
+}
+
+static void
+name(void)
+{
+    static const char *const words[] = {
+        "album", "disc", "episode", "extras", "images", "season", "track",
+        "caf\xc3\xa9", "na\xc3\xafve", "\xe6\x97\xa5\xe6\x9c\xac",
+        "\xd0\xbc\xd1\x83\xd0\xb7\xd1\x8b\xd0\xba\xd0\xb0",
+        "s\xe9rie", "\xe9t\xe9" /* Latin-1, not UTF-8 */
+    };
+    static const char *const exts[] = {
+        ".flac", ".jpg", ".mkv", ".nfo", ".srt", ".txt"
+    };
+    char buf[128];
+    const char *w = words[rng() % (sizeof(words) / sizeof(*words))];
+    sprintf(buf, "%s %02lu%s", w, rng() % 100,
+            exts[rng() % (sizeof(exts) / sizeof(*exts))]);
+    string(buf, strlen(buf));
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned long i, j, nfiles = argc > 1 ? strtoul(argv[1], 0, 10) : 20000;
+    unsigned long *lengths = malloc((nfiles + 1) * sizeof(*lengths));
+    unsigned long npieces = 0, rem = 0;
+
+    if (!lengths) {
+        fprintf(stderr, "torrentgen: out of memory\n");
+        return EXIT_FAILURE;
+    }
+    for (i = 0; i < nfiles; i++) {
+        lengths[i] = rng() % (8UL << 20);
+        npieces += lengths[i] / PIECE_LENGTH;
+        rem += lengths[i] % PIECE_LENGTH;
+        npieces += rem / PIECE_LENGTH;
+        rem %= PIECE_LENGTH;
+    }
+    npieces += rem > 0;
+
+    putchar(0x64); /* d */
+    key("announce");
+    key("http://tracker.example.org:6969/announce");
+    key("announce-list");
+    putchar(0x6c); /* l */
+    for (i = 0; i < 4; i++) {
+        char url[64];
+        sprintf(url, "udp://tracker%lu.example.net:1337/announce", i);
+        putchar(0x6c); /* l */
+        string(url, strlen(url));
+        putchar(0x65); /* e */
+    }
+    putchar(0x65); /* e */
+    key("comment");
+    key("Benchmark input for bencode2json");
+    key("created by");
+    key("torrentgen");
+    key("creation date");
+    printf("i1700000000e");
+
+    key("info");
+    putchar(0x64); /* d */
+    key("files");
+    putchar(0x6c); /* l */
+    for (i = 0; i < nfiles; i++) {
+        putchar(0x64); /* d */
+        key("length");
+        printf("i%lue", lengths[i]);
+        key("path");
+        putchar(0x6c); /* l */
+        for (j = rng() % 3; j; j--)
+            name();
+        name();
+        putchar(0x65); /* e, path */
+        putchar(0x65); /* e, file */
+    }
+    putchar(0x65); /* e */
+    key("name");
+    key("Benchmark collection");
+    key("piece length");
+    printf("i%lue", PIECE_LENGTH);
+    key("pieces");
+    printf("%lu:", npieces * 20);
+    for (i = 0; i < npieces * 20; i++)
+        putchar(rng() & 0xff);
+    putchar(0x65); /* e, info */
+    putchar(0x65); /* e */
+
+    free(lengths);
+    return ferror(stdout) ? EXIT_FAILURE : EXIT_SUCCESS;
+}